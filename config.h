@@ -24,6 +24,8 @@ settings_t defaults = {
 .indicate_hidden = true,     /* show count of hidden messages */
 .idle_threshold = 0,         /* don't timeout notifications when idle for x seconds */
 .show_age_threshold = -1,    /* show age of notification, when notification is older than x seconds */
+.max_frame_rate = 0,         /* maximum redraws per second, 0 for no limit */
+.rule_timing = false,        /* measure the time spent matching each rule */
 .align = left,               /* text alignment [left/center/right] */
 .sticky_history = true,
 .history_length = 20,        /* max amount of notifications kept in history */
@@ -62,6 +64,9 @@ settings_t defaults = {
 /* paths to default icons */
 .icon_path = "/usr/share/icons/gnome/16x16/status/:/usr/share/icons/gnome/16x16/devices/",
 
+.icon_cache_entries = 64,    /* number of loaded icons to keep, 0 to disable the cache */
+.icon_cache_size = 4096,     /* memory for the cached icons in kilobytes */
+
 
 /* follow focus to different monitor and display notifications there?
  * possible values:
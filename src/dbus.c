@@ -7,9 +7,12 @@
 #include <stdlib.h>
 
 #include "dunst.h"
+#include "icon.h"
+#include "intern.h"
 #include "log.h"
 #include "notification.h"
 #include "queues.h"
+#include "rules.h"
 #include "settings.h"
 #include "utils.h"
 
@@ -17,10 +20,50 @@
 #define FDN_IFAC "org.freedesktop.Notifications"
 #define FDN_NAME "org.freedesktop.Notifications"
 
+#define DUNST_IFAC "org.dunstproject.cmd0"
+
 GDBusConnection *dbus_conn;
 
 static GDBusNodeInfo *introspection_data = NULL;
 
+/*
+ * A notification, which got replied to but not processed yet
+ */
+struct pending_notification {
+        notification *n;
+        bool replaces;  /* n->id was requested by the sender */
+};
+
+/* The idle source flushing the connection */
+static guint flush_source = 0;
+
+static gboolean dbus_flush_idle(gpointer data)
+{
+        flush_source = 0;
+        g_dbus_connection_flush(data, NULL, NULL, NULL);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Flush the replies and signals of the current main loop iteration
+ * together instead of after every single message.
+ */
+static void dbus_flush_later(GDBusConnection *connection)
+{
+        if (flush_source || !connection)
+                return;
+
+        flush_source = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                                       dbus_flush_idle,
+                                       g_object_ref(connection),
+                                       g_object_unref);
+}
+
+/* The pending notifications in the order they were received */
+static GQueue pending = G_QUEUE_INIT;
+static guint pending_source = 0;
+
 static const char *introspection_xml =
     "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
     "<node name=\""FDN_PATH"\">"
@@ -63,6 +106,17 @@ static const char *introspection_xml =
     "            <arg name=\"action_key\" type=\"s\"/>"
     "        </signal>"
     "   </interface>"
+
+    "    <interface name=\""DUNST_IFAC"\">"
+
+    "        <method name=\"GetRuleStats\">"
+    "            <arg direction=\"out\" name=\"rules\"           type=\"a(sttt)\"/>"
+    "            <arg direction=\"out\" name=\"notifications\"   type=\"t\"/>"
+    "            <arg direction=\"out\" name=\"time_ns\"         type=\"t\"/>"
+    "            <arg direction=\"out\" name=\"memo_hits\"       type=\"t\"/>"
+    "            <arg direction=\"out\" name=\"memo_misses\"     type=\"t\"/>"
+    "        </method>"
+    "   </interface>"
     "</node>";
 
 static void on_get_capabilities(GDBusConnection *connection,
@@ -81,7 +135,10 @@ static void on_get_server_information(GDBusConnection *connection,
                                       const gchar *sender,
                                       const GVariant *parameters,
                                       GDBusMethodInvocation *invocation);
-static RawImage *get_raw_image_from_data_hint(GVariant *icon_data);
+static void on_get_rule_stats(GDBusConnection *connection,
+                              const gchar *sender,
+                              const GVariant *parameters,
+                              GDBusMethodInvocation *invocation);
 
 void handle_method_call(GDBusConnection *connection,
                         const gchar *sender,
@@ -107,6 +164,51 @@ void handle_method_call(GDBusConnection *connection,
         }
 }
 
+void handle_dunst_method_call(GDBusConnection *connection,
+                              const gchar *sender,
+                              const gchar *object_path,
+                              const gchar *interface_name,
+                              const gchar *method_name,
+                              GVariant *parameters,
+                              GDBusMethodInvocation *invocation,
+                              gpointer user_data)
+{
+        if (g_strcmp0(method_name, "GetRuleStats") == 0) {
+                on_get_rule_stats(connection, sender, parameters, invocation);
+        } else {
+                LOG_M("Unknown method name: '%s' (sender: '%s').",
+                      method_name,
+                      sender);
+        }
+}
+
+static void on_get_rule_stats(GDBusConnection *connection,
+                              const gchar *sender,
+                              const GVariant *parameters,
+                              GDBusMethodInvocation *invocation)
+{
+        GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a(sttt)"));
+
+        for (GSList *iter = rules; iter; iter = iter->next) {
+                const rule_t *r = iter->data;
+                g_variant_builder_add(builder, "(sttt)",
+                                      r->name ? r->name : "",
+                                      r->stats.evaluations,
+                                      r->stats.matches,
+                                      r->stats.time_ns);
+        }
+
+        const struct rule_stats *total = rules_get_total_stats();
+        const struct rule_memo_stats *memo = rules_get_memo_stats();
+        GVariant *value = g_variant_new("(a(sttt)tttt)", builder,
+                                        total->evaluations, total->time_ns,
+                                        memo->hits, memo->misses);
+        g_variant_builder_unref(builder);
+        g_dbus_method_invocation_return_value(invocation, value);
+
+        dbus_flush_later(connection);
+}
+
 static void on_get_capabilities(GDBusConnection *connection,
                                 const gchar *sender,
                                 const GVariant *parameters,
@@ -127,7 +229,7 @@ static void on_get_capabilities(GDBusConnection *connection,
         g_variant_builder_unref(builder);
         g_dbus_method_invocation_return_value(invocation, value);
 
-        g_dbus_connection_flush(connection, NULL, NULL, NULL);
+        dbus_flush_later(connection);
 }
 
 static notification *dbus_message_to_notification(const gchar *sender, GVariant *parameters)
@@ -269,15 +371,15 @@ static notification *dbus_message_to_notification(const gchar *sender, GVariant
         notification *n = notification_create();
 
         n->id = replaces_id;
-        n->appname = appname;
+        n->appname = intern_take(appname);
         n->summary = summary;
         n->body = body;
-        n->icon = icon;
+        n->icon = intern_take(icon);
         n->raw_icon = raw_icon;
         n->timeout = timeout < 0 ? -1 : timeout * 1000;
         n->progress = progress;
         n->urgency = urgency;
-        n->category = category;
+        n->category = intern_take(category);
         n->dbus_client = g_strdup(sender);
         n->transient = transient;
 
@@ -287,32 +389,99 @@ static notification *dbus_message_to_notification(const gchar *sender, GVariant
         }
         n->actions = actions;
 
-        n->colors[ColFG] = fgcolor;
-        n->colors[ColBG] = bgcolor;
+        n->colors[ColFG] = intern_take(fgcolor);
+        n->colors[ColBG] = intern_take(bgcolor);
 
-        notification_init(n);
         return n;
 }
 
+/*
+ * Initialize a received notification and insert it into the queues.
+ */
+static void dbus_process_notification(struct pending_notification *p)
+{
+        notification *n = p->n;
+
+        n->raw_icon = icon_ingest_raw_image(n->raw_icon, settings.max_icon_size);
+        notification_init(n);
+
+        // The message got discarded
+        if (queues_notification_insert(n, p->replaces) == 0) {
+                signal_notification_closed(n, REASON_USER);
+                notification_free(n);
+        }
+
+        g_free(p);
+}
+
+/* see dbus.h */
+bool dbus_process_pending(void)
+{
+        if (g_queue_is_empty(&pending))
+                return false;
+
+        struct pending_notification *p;
+        while ((p = g_queue_pop_head(&pending)))
+                dbus_process_notification(p);
+
+        return true;
+}
+
+static gboolean dbus_process_pending_idle(gpointer data)
+{
+        pending_source = 0;
+
+        if (dbus_process_pending())
+                wake_up();
+
+        return G_SOURCE_REMOVE;
+}
+
+/* see dbus.h */
+guint32 dbus_queue_notification(notification *n)
+{
+        struct pending_notification *p = g_malloc(sizeof(struct pending_notification));
+
+        p->n = n;
+        p->replaces = n->id != 0;
+        if (!p->replaces)
+                n->id = queues_reserve_id();
+
+        /* Processed in the order of arrival, so a replacing notification
+         * always comes after the one it replaces */
+        g_queue_push_tail(&pending, p);
+        if (!pending_source)
+                pending_source = g_idle_add(dbus_process_pending_idle, NULL);
+
+        return n->id;
+}
+
+/* see dbus.h */
+void dbus_close_notification(guint32 id)
+{
+        /* the notification to close may still be pending */
+        dbus_process_pending();
+
+        queues_notification_close_id(id, REASON_SIG);
+}
+
+/*
+ * Reply to Notify right after parsing the message. Everything else, like
+ * applying the rules, formatting and rendering, gets deferred into an idle
+ * source, so that a burst of notifications gets parsed back to back and
+ * rendered once.
+ */
 static void on_notify(GDBusConnection *connection,
                       const gchar *sender,
                       GVariant *parameters,
                       GDBusMethodInvocation *invocation)
 {
         notification *n = dbus_message_to_notification(sender, parameters);
-        int id = queues_notification_insert(n);
+        guint32 id = dbus_queue_notification(n);
 
         GVariant *reply = g_variant_new("(u)", id);
         g_dbus_method_invocation_return_value(invocation, reply);
-        g_dbus_connection_flush(connection, NULL, NULL, NULL);
-
-        // The message got discarded
-        if (id == 0) {
-                signal_notification_closed(n, 2);
-                notification_free(n);
-        }
-
-        wake_up();
+        dbus_flush_later(connection);
 }
 
 static void on_close_notification(GDBusConnection *connection,
@@ -322,10 +491,11 @@ static void on_close_notification(GDBusConnection *connection,
 {
         guint32 id;
         g_variant_get(parameters, "(u)", &id);
-        queues_notification_close_id(id, REASON_SIG);
+
+        dbus_close_notification(id);
         wake_up();
         g_dbus_method_invocation_return_value(invocation, NULL);
-        g_dbus_connection_flush(connection, NULL, NULL, NULL);
+        dbus_flush_later(connection);
 }
 
 static void on_get_server_information(GDBusConnection *connection,
@@ -338,7 +508,7 @@ static void on_get_server_information(GDBusConnection *connection,
         value = g_variant_new("(ssss)", "dunst", "knopwob", VERSION, "1.2");
         g_dbus_method_invocation_return_value(invocation, value);
 
-        g_dbus_connection_flush(connection, NULL, NULL, NULL);
+        dbus_flush_later(connection);
 }
 
 void signal_notification_closed(notification *n, enum reason reason)
@@ -363,6 +533,7 @@ void signal_notification_closed(notification *n, enum reason reason)
                                       "NotificationClosed",
                                       body,
                                       &err);
+        dbus_flush_later(dbus_conn);
 
         if (err) {
                 LOG_W("Unable to close notification: %s", err->message);
@@ -383,6 +554,7 @@ void signal_action_invoked(notification *n, const char *identifier)
                                       "ActionInvoked",
                                       body,
                                       &err);
+        dbus_flush_later(dbus_conn);
 
         if (err) {
                 LOG_W("Unable to invoke action: %s", err->message);
@@ -394,6 +566,10 @@ static const GDBusInterfaceVTable interface_vtable = {
         handle_method_call
 };
 
+static const GDBusInterfaceVTable dunst_interface_vtable = {
+        handle_dunst_method_call
+};
+
 static void on_bus_acquired(GDBusConnection *connection,
                             const gchar *name,
                             gpointer user_data)
@@ -413,6 +589,18 @@ static void on_bus_acquired(GDBusConnection *connection,
         if (registration_id == 0) {
                 DIE("Unable to register dbus connection: %s", err->message);
         }
+
+        registration_id = g_dbus_connection_register_object(connection,
+                                                            FDN_PATH,
+                                                            introspection_data->interfaces[1],
+                                                            &dunst_interface_vtable,
+                                                            NULL,
+                                                            NULL,
+                                                            &err);
+
+        if (registration_id == 0) {
+                DIE("Unable to register dbus connection: %s", err->message);
+        }
 }
 
 static void on_name_acquired(GDBusConnection *connection,
@@ -548,7 +736,8 @@ static void on_name_lost(GDBusConnection *connection,
         exit(1);
 }
 
-static RawImage *get_raw_image_from_data_hint(GVariant *icon_data)
+/* see dbus.h */
+RawImage *get_raw_image_from_data_hint(GVariant *icon_data)
 {
         RawImage *image = g_malloc(sizeof(RawImage));
         GVariant *data_variant;
@@ -577,8 +766,10 @@ static RawImage *get_raw_image_from_data_hint(GVariant *icon_data)
                 return NULL;
         }
 
-        image->data = (guchar *) g_memdup(g_variant_get_data(data_variant),
-                                          g_variant_get_size(data_variant));
+        /* Reference the pixels in the message instead of copying them */
+        image->bytes = g_variant_get_data_as_bytes(data_variant);
+        image->data = g_bytes_get_data(image->bytes, NULL);
+        image->argb32 = false;
         g_variant_unref(data_variant);
 
         return image;
@@ -612,7 +803,26 @@ void dbus_tear_down(int owner_id)
         if (introspection_data)
                 g_dbus_node_info_unref(introspection_data);
 
-        g_bus_unown_name(owner_id);
+        if (pending_source)
+                g_source_remove(pending_source);
+        pending_source = 0;
+
+        /* send out what's left, there is no main loop iteration anymore */
+        if (flush_source) {
+                g_source_remove(flush_source);
+                flush_source = 0;
+                if (dbus_conn)
+                        g_dbus_connection_flush_sync(dbus_conn, NULL, NULL);
+        }
+
+        struct pending_notification *p;
+        while ((p = g_queue_pop_head(&pending))) {
+                notification_free(p->n);
+                g_free(p);
+        }
+
+        if (owner_id)
+                g_bus_unown_name(owner_id);
 }
 
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
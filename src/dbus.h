@@ -21,5 +21,41 @@ void dbus_tear_down(int id);
 void signal_notification_closed(notification *n, enum reason reason);
 void signal_action_invoked(notification *n, const char *identifier);
 
+/**
+ * Insert all received notifications, which were not processed yet, into
+ * the queues.
+ *
+ * @return true, if there were pending notifications
+ */
+bool dbus_process_pending(void);
+
+/**
+ * Queue a received notification to get processed on the next idle
+ * iteration of the main loop, after all notifications received before.
+ *
+ * @param n The notification, its id set if it replaces another one
+ * @return The id of the notification, as to reply to the sender
+ */
+guint32 dbus_queue_notification(notification *n);
+
+/**
+ * Close the notification with the given id on request of a client,
+ * including a notification still waiting to get processed.
+ *
+ * @param id The id of the notification to close
+ */
+void dbus_close_notification(guint32 id);
+
+/**
+ * Parse the `image-data` hint of a notification.
+ *
+ * The pixels are referenced, not copied: the returned image holds its own
+ * reference on them and stays valid after @p icon_data is gone.
+ *
+ * @param icon_data A GVariant of type `(iiibiiay)`
+ * @return The image or NULL, if the size of the data does not match
+ */
+RawImage *get_raw_image_from_data_hint(GVariant *icon_data);
+
 #endif
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -13,12 +13,15 @@
 #include <stdlib.h>
 
 #include "dbus.h"
+#include "format.h"
+#include "icon.h"
 #include "log.h"
 #include "menu.h"
 #include "notification.h"
 #include "option_parser.h"
 #include "queues.h"
 #include "settings.h"
+#include "utils.h"
 #include "x11/screen.h"
 #include "x11/x.h"
 
@@ -41,9 +44,39 @@ GSList *rules = NULL;
 /* misc funtions */
 static gboolean run(void *data);
 
-void wake_up(void)
+/* the pending redraw scheduled by wake_up() */
+static guint wakeup_src = 0;
+/* the time run() last drew the window */
+static gint64 last_draw = 0;
+
+static gboolean wake_up_scheduled(gpointer data)
 {
+        wakeup_src = 0;
         run(NULL);
+
+        return G_SOURCE_REMOVE;
+}
+
+/*
+ * Schedule a single run() for all changes of the current main loop
+ * iteration. With max_frame_rate set and the window shown, the run gets
+ * delayed until a frame has passed since the last draw.
+ */
+void wake_up(void)
+{
+        if (wakeup_src)
+                return;
+
+        gint64 delay = 0;
+
+        if (xctx.visible)
+                delay = frame_delay(g_get_monotonic_time(), last_draw,
+                                    settings.max_frame_rate);
+
+        if (delay > 0)
+                wakeup_src = g_timeout_add((delay + 999) / 1000, wake_up_scheduled, NULL);
+        else
+                wakeup_src = g_idle_add(wake_up_scheduled, NULL);
 }
 
 static gboolean run(void *data)
@@ -67,6 +100,7 @@ static gboolean run(void *data)
 
         if (xctx.visible) {
                 x_win_draw();
+                last_draw = g_get_monotonic_time();
         }
 
         if (xctx.visible) {
@@ -117,8 +151,12 @@ static void teardown(void)
 {
         regex_teardown();
 
+        format_teardown();
+
         teardown_queues();
 
+        icon_teardown();
+
         x_free();
 }
 
@@ -166,7 +204,7 @@ int dunst_main(int argc, char *argv[])
                 n->markup = MARKUP_NO;
                 n->urgency = URG_LOW;
                 notification_init(n);
-                queues_notification_insert(n);
+                queues_notification_insert(n, false);
                 // we do not call wakeup now, wake_up does not work here yet
         }
 
@@ -210,6 +248,8 @@ int dunst_main(int argc, char *argv[])
         g_source_remove(unpause_src);
         g_source_remove(term_src);
         g_source_remove(int_src);
+        if (wakeup_src)
+                g_source_remove(wakeup_src);
 
         g_source_destroy(x11_source);
 
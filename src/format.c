@@ -0,0 +1,226 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "format.h"
+
+#include <glib.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "markup.h"
+
+/** All compiled templates: format string -> format_template */
+static GHashTable *templates = NULL;
+
+/**
+ * Free a compiled template
+ */
+static void format_template_free(gpointer data)
+{
+        format_template *t = data;
+
+        g_free(t->literals);
+        g_free(t->tokens);
+        g_free(t);
+}
+
+/**
+ * Add a token to the program, merging adjacent literals
+ *
+ * @param tokens The program
+ * @param literals The literal text of the template
+ * @param type The type of the token
+ * @param text The literal text to add, if `type` is #FORMAT_LITERAL
+ * @param len The length of `text`
+ */
+static void format_emit(GArray *tokens,
+                        GString *literals,
+                        enum format_token_type type,
+                        const char *text,
+                        gsize len)
+{
+        if (type != FORMAT_LITERAL) {
+                struct format_token token = { type, 0, 0 };
+                g_array_append_val(tokens, token);
+                return;
+        }
+
+        if (tokens->len > 0) {
+                struct format_token *last =
+                        &g_array_index(tokens, struct format_token, tokens->len - 1);
+                if (last->type == FORMAT_LITERAL) {
+                        g_string_append_len(literals, text, len);
+                        last->len += len;
+                        return;
+                }
+        }
+
+        struct format_token token = { FORMAT_LITERAL, literals->len, len };
+        g_string_append_len(literals, text, len);
+        g_array_append_val(tokens, token);
+}
+
+/**
+ * Parse a format string into a template
+ */
+static format_template *format_parse(const char *format)
+{
+        GArray *tokens = g_array_new(FALSE, FALSE, sizeof(struct format_token));
+        GString *literals = g_string_new(NULL);
+
+        for (const char *substr = format; *substr; substr++) {
+                if (substr[0] == '\\' && substr[1] == 'n') {
+                        format_emit(tokens, literals, FORMAT_LITERAL, "\n", 1);
+                        substr++;
+                        continue;
+                }
+
+                if (substr[0] != '%') {
+                        format_emit(tokens, literals, FORMAT_LITERAL, substr, 1);
+                        continue;
+                }
+
+                enum format_token_type type;
+                switch (substr[1]) {
+                case 'a': type = FORMAT_APPNAME; break;
+                case 's': type = FORMAT_SUMMARY; break;
+                case 'b': type = FORMAT_BODY; break;
+                case 'I': type = FORMAT_ICON_BASENAME; break;
+                case 'i': type = FORMAT_ICON; break;
+                case 'p': type = FORMAT_PROGRESS; break;
+                case 'n': type = FORMAT_PROGRESS_VALUE; break;
+                case '%':
+                        format_emit(tokens, literals, FORMAT_LITERAL, "%", 1);
+                        substr++;
+                        continue;
+                case '\0':
+                        LOG_W("format_string has trailing %% character. "
+                              "To escape it use %%%%.");
+                        format_emit(tokens, literals, FORMAT_LITERAL, "%", 1);
+                        continue;
+                default:
+                        LOG_W("format_string %%%c is unknown.", substr[1]);
+                        // keep the format string as is,
+                        // as we can't interpret it
+                        format_emit(tokens, literals, FORMAT_LITERAL, "%", 1);
+                        continue;
+                }
+
+                format_emit(tokens, literals, type, NULL, 0);
+                substr++;
+        }
+
+        format_template *t = g_malloc(sizeof(format_template));
+        t->n_tokens = tokens->len;
+        t->tokens = (struct format_token *) g_array_free(tokens, FALSE);
+        t->literals = g_string_free(literals, FALSE);
+
+        return t;
+}
+
+/* see format.h */
+const format_template *format_compile(const char *format)
+{
+        if (!templates)
+                templates = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                  g_free, format_template_free);
+
+        format_template *t = g_hash_table_lookup(templates, format);
+
+        if (!t) {
+                t = format_parse(format);
+                g_hash_table_insert(templates, g_strdup(format), t);
+        }
+
+        return t;
+}
+
+/* see format.h */
+void format_teardown(void)
+{
+        if (templates)
+                g_hash_table_destroy(templates);
+        templates = NULL;
+}
+
+/* see format.h */
+char *format_render(const format_template *t, const notification *n)
+{
+        struct span {
+                const char *str;
+                gsize len;
+                char *owned;
+        } *spans = g_new0(struct span, t->n_tokens);
+        gsize size = 0;
+
+        for (guint i = 0; i < t->n_tokens; i++) {
+                const struct format_token *token = &t->tokens[i];
+                struct span *span = &spans[i];
+                char *icon_tmp;
+                char pg[16];
+
+                switch (token->type) {
+                case FORMAT_LITERAL:
+                        span->str = t->literals + token->offset;
+                        span->len = token->len;
+                        break;
+                case FORMAT_APPNAME:
+                        span->owned = markup_transform(g_strdup(n->appname), MARKUP_NO);
+                        break;
+                case FORMAT_SUMMARY:
+                        span->owned = markup_transform(g_strdup(n->summary), n->markup);
+                        break;
+                case FORMAT_BODY:
+                        span->owned = markup_transform(g_strdup(n->body), n->markup);
+                        break;
+                case FORMAT_ICON_BASENAME:
+                        icon_tmp = g_strdup(n->icon);
+                        span->owned = markup_transform(g_strdup(icon_tmp ? basename(icon_tmp) : ""),
+                                                       MARKUP_NO);
+                        g_free(icon_tmp);
+                        break;
+                case FORMAT_ICON:
+                        span->owned = markup_transform(g_strdup(n->icon ? n->icon : ""), MARKUP_NO);
+                        break;
+                case FORMAT_PROGRESS:
+                case FORMAT_PROGRESS_VALUE:
+                        if (n->progress == -1)
+                                break;
+
+                        sprintf(pg, token->type == FORMAT_PROGRESS ? "[%3d%%]" : "%d",
+                                n->progress);
+                        span->owned = markup_transform(g_strdup(pg), MARKUP_NO);
+                        break;
+                }
+
+                if (span->owned) {
+                        span->str = span->owned;
+                        span->len = strlen(span->owned);
+                }
+                size += span->len;
+        }
+
+        char *msg = g_malloc(size + 1);
+        char *pos = msg;
+        for (guint i = 0; i < t->n_tokens; i++) {
+                if (spans[i].len > 0)
+                        memcpy(pos, spans[i].str, spans[i].len);
+                pos += spans[i].len;
+                g_free(spans[i].owned);
+        }
+        g_free(spans);
+
+        /* strip trailing whitespace */
+        while (size > 0 && g_ascii_isspace(msg[size - 1]))
+                size--;
+
+        /* truncate overlong messages */
+        if (size > DUNST_NOTIF_MAX_CHARS)
+                size = DUNST_NOTIF_MAX_CHARS - 1;
+
+        msg[size] = '\0';
+
+        return msg;
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
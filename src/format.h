@@ -0,0 +1,72 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_FORMAT_H
+#define DUNST_FORMAT_H
+
+#include <glib.h>
+
+#include "notification.h"
+
+/**
+ * The parts of a compiled format string
+ */
+enum format_token_type {
+        FORMAT_LITERAL,        /**< plain text of the format string */
+        FORMAT_APPNAME,        /**< `%a` */
+        FORMAT_SUMMARY,        /**< `%s` */
+        FORMAT_BODY,           /**< `%b` */
+        FORMAT_ICON_BASENAME,  /**< `%I` */
+        FORMAT_ICON,           /**< `%i` */
+        FORMAT_PROGRESS,       /**< `%p` */
+        FORMAT_PROGRESS_VALUE, /**< `%n` */
+};
+
+struct format_token {
+        enum format_token_type type;
+        gsize offset; /**< start of the text inside #format_template.literals, if #FORMAT_LITERAL */
+        gsize len;    /**< length of the text, if #FORMAT_LITERAL */
+};
+
+/**
+ * A format string parsed into literals and field references
+ */
+typedef struct _format_template {
+        char *literals;               /**< the text of all literal tokens */
+        struct format_token *tokens;  /**< the program to render */
+        guint n_tokens;               /**< amount of #tokens */
+} format_template;
+
+/**
+ * Get the compiled template of a format string
+ *
+ * Every distinct format string gets compiled only once. Problems in the
+ * format string get logged while compiling.
+ *
+ * @param format The format string, as given in the settings or a rule
+ *
+ * @return (transfer none) the compiled template
+ */
+const format_template *format_compile(const char *format);
+
+/**
+ * Render the message of a notification from a compiled template
+ *
+ * The fields get transformed according to the notification's markup
+ * mode and trailing whitespace gets stripped. Messages longer than
+ * #DUNST_NOTIF_MAX_CHARS get truncated to one character less.
+ *
+ * @param t The compiled template
+ * @param n The notification to take the fields from
+ *
+ * @return (transfer full) the formatted message
+ */
+char *format_render(const format_template *t, const notification *n);
+
+/**
+ * Free all compiled templates
+ *
+ * Templates returned by format_compile() before are invalid afterwards.
+ */
+void format_teardown(void);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,357 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "globset.h"
+
+#include <assert.h>
+#include <glib.h>
+#include <string.h>
+
+/** Marks a missing transition while the trie gets built */
+#define NO_STATE G_MAXUINT
+
+/** Marks a pattern, which can't match anymore */
+#define DEAD G_MAXUINT
+
+/**
+ * A literal part of a pattern between two stars
+ */
+struct fragment {
+        const char *str; /**< points into the copy of the pattern */
+        gsize len;
+};
+
+/**
+ * A single glob pattern, split at its stars
+ *
+ * A pattern like "ab*cd*ef" consists of the fragments "ab", "cd" and "ef".
+ * The first fragment has to match at the start of the text (head), the last
+ * one at its end (tail). All fragments in between get searched for with the
+ * automaton, each one after the end of the previous one.
+ */
+struct pattern {
+        guint id;
+        char *glob;              /**< the copy of the pattern */
+        struct fragment *frags;
+        guint n_frags;
+        bool literal;            /**< the pattern has no stars at all */
+        bool head;               /**< the pattern does not start with a star */
+        bool tail;               /**< the pattern does not end with a star */
+};
+
+/**
+ * A pattern waiting for one of its fragments
+ */
+struct waiter {
+        guint pattern; /**< the index into the patterns */
+        guint index;   /**< the position of the fragment in the pattern */
+        gsize len;     /**< the length of the fragment */
+};
+
+struct _globset {
+        GArray *patterns;       /**< struct pattern */
+        bool built;
+
+        guint8 classes[256];    /**< byte -> class, 0 for bytes not in any fragment */
+        guint n_classes;
+
+        guint n_states;
+        guint *trans;           /**< state * n_classes + class -> state */
+        guint *dict;            /**< the longest proper suffix state with waiters, 0 if none */
+        guint *out_start;       /**< the waiters of a state are [out_start[s], out_start[s + 1]) */
+        struct waiter *waiters;
+};
+
+/**
+ * @return the index of the first fragment to search with the automaton
+ */
+static inline guint pattern_mid_begin(const struct pattern *p)
+{
+        return p->head ? 1 : 0;
+}
+
+/**
+ * @return the index after the last fragment to search with the automaton
+ */
+static inline guint pattern_mid_end(const struct pattern *p)
+{
+        return p->tail ? p->n_frags - 1 : p->n_frags;
+}
+
+/* see globset.h */
+globset *globset_new(void)
+{
+        globset *gs = g_malloc0(sizeof(globset));
+        gs->patterns = g_array_new(false, false, sizeof(struct pattern));
+        return gs;
+}
+
+/* see globset.h */
+void globset_free(globset *gs)
+{
+        if (!gs)
+                return;
+
+        for (guint i = 0; i < gs->patterns->len; i++) {
+                struct pattern *p = &g_array_index(gs->patterns, struct pattern, i);
+                g_free(p->glob);
+                g_free(p->frags);
+        }
+        g_array_free(gs->patterns, true);
+
+        g_free(gs->trans);
+        g_free(gs->dict);
+        g_free(gs->out_start);
+        g_free(gs->waiters);
+        g_free(gs);
+}
+
+/* see globset.h */
+bool globset_add(globset *gs, const char *pattern, guint id)
+{
+        assert(!gs->built);
+
+        if (strpbrk(pattern, "?[\\"))
+                return false;
+
+        struct pattern p = { 0 };
+        gsize len = strlen(pattern);
+
+        p.id = id;
+        p.glob = g_strdup(pattern);
+        p.literal = !strchr(pattern, '*');
+        p.head = len == 0 || pattern[0] != '*';
+        p.tail = len == 0 || pattern[len - 1] != '*';
+        p.frags = g_new(struct fragment, len / 2 + 1);
+
+        for (char *start = p.glob; *start; ) {
+                char *end = strchr(start, '*');
+                gsize frag_len = end ? (gsize) (end - start) : strlen(start);
+
+                if (frag_len > 0) {
+                        p.frags[p.n_frags].str = start;
+                        p.frags[p.n_frags].len = frag_len;
+                        p.n_frags++;
+                }
+                start += frag_len + (end ? 1 : 0);
+        }
+
+        g_array_append_val(gs->patterns, p);
+        return true;
+}
+
+/**
+ * Add a new state without any transitions to the trie
+ */
+static guint globset_add_state(GArray *trans, guint n_classes)
+{
+        guint state = trans->len / n_classes;
+        guint none = NO_STATE;
+
+        for (guint c = 0; c < n_classes; c++)
+                g_array_append_val(trans, none);
+
+        return state;
+}
+
+/* see globset.h */
+void globset_build(globset *gs)
+{
+        assert(!gs->built);
+        gs->built = true;
+
+        /* Collect the bytes used in the fragments into classes */
+        gs->n_classes = 1;
+        for (guint i = 0; i < gs->patterns->len; i++) {
+                struct pattern *p = &g_array_index(gs->patterns, struct pattern, i);
+                if (p->literal)
+                        continue;
+
+                for (guint k = pattern_mid_begin(p); k < pattern_mid_end(p); k++) {
+                        for (gsize j = 0; j < p->frags[k].len; j++) {
+                                guint8 b = p->frags[k].str[j];
+                                if (!gs->classes[b])
+                                        gs->classes[b] = gs->n_classes++;
+                        }
+                }
+        }
+
+        /* Put all fragments into the trie and remember who waits for them */
+        GArray *trans = g_array_new(false, false, sizeof(guint));
+        GArray *states = g_array_new(false, false, sizeof(guint));
+        GArray *waiters = g_array_new(false, false, sizeof(struct waiter));
+
+        globset_add_state(trans, gs->n_classes);
+
+        for (guint i = 0; i < gs->patterns->len; i++) {
+                struct pattern *p = &g_array_index(gs->patterns, struct pattern, i);
+                if (p->literal)
+                        continue;
+
+                for (guint k = pattern_mid_begin(p); k < pattern_mid_end(p); k++) {
+                        guint s = 0;
+                        for (gsize j = 0; j < p->frags[k].len; j++) {
+                                guint c = gs->classes[(guint8) p->frags[k].str[j]];
+                                guint t = g_array_index(trans, guint, s * gs->n_classes + c);
+                                if (t == NO_STATE) {
+                                        t = globset_add_state(trans, gs->n_classes);
+                                        g_array_index(trans, guint, s * gs->n_classes + c) = t;
+                                }
+                                s = t;
+                        }
+
+                        struct waiter w = { i, k, p->frags[k].len };
+                        g_array_append_val(states, s);
+                        g_array_append_val(waiters, w);
+                }
+        }
+
+        gs->n_states = trans->len / gs->n_classes;
+        gs->trans = (guint *) g_array_free(trans, false);
+
+        /* Group the waiters by their state, keeping the order of the patterns */
+        gs->out_start = g_new0(guint, gs->n_states + 1);
+        gs->waiters = g_new(struct waiter, waiters->len);
+
+        for (guint i = 0; i < states->len; i++)
+                gs->out_start[g_array_index(states, guint, i) + 1]++;
+        for (guint s = 0; s < gs->n_states; s++)
+                gs->out_start[s + 1] += gs->out_start[s];
+
+        guint *fill = g_new(guint, gs->n_states);
+        memcpy(fill, gs->out_start, gs->n_states * sizeof(guint));
+        for (guint i = 0; i < states->len; i++) {
+                guint s = g_array_index(states, guint, i);
+                gs->waiters[fill[s]++] = g_array_index(waiters, struct waiter, i);
+        }
+        g_free(fill);
+        g_array_free(states, true);
+        g_array_free(waiters, true);
+
+        /* Turn the trie into a DFA by following the failure links breadth first */
+        guint *fail = g_new0(guint, gs->n_states);
+        guint *queue = g_new(guint, gs->n_states);
+        guint head = 0, tail = 0;
+
+        gs->dict = g_new0(guint, gs->n_states);
+
+        for (guint c = 0; c < gs->n_classes; c++) {
+                guint t = gs->trans[c];
+                if (t == NO_STATE) {
+                        gs->trans[c] = 0;
+                } else {
+                        fail[t] = 0;
+                        queue[tail++] = t;
+                }
+        }
+
+        while (head < tail) {
+                guint u = queue[head++];
+                guint *row = gs->trans + u * gs->n_classes;
+                const guint *fail_row = gs->trans + fail[u] * gs->n_classes;
+
+                for (guint c = 0; c < gs->n_classes; c++) {
+                        guint t = row[c];
+                        if (t == NO_STATE) {
+                                row[c] = fail_row[c];
+                                continue;
+                        }
+
+                        guint f = fail_row[c];
+                        fail[t] = f;
+                        gs->dict[t] = gs->out_start[f] < gs->out_start[f + 1] ? f : gs->dict[f];
+                        queue[tail++] = t;
+                }
+        }
+
+        g_free(queue);
+        g_free(fail);
+}
+
+/* see globset.h */
+guint globset_size(const globset *gs)
+{
+        return gs->patterns->len;
+}
+
+/* see globset.h */
+void globset_match(const globset *gs, const char *text, guint32 *bits)
+{
+        assert(gs->built);
+
+        if (!text)
+                text = "";
+
+        struct progress {
+                guint next;       /**< the next fragment to find */
+                gsize min_start;  /**< the earliest position it may start at */
+        } *run = g_new(struct progress, gs->patterns->len);
+        bool scan = false;
+
+        for (guint i = 0; i < gs->patterns->len; i++) {
+                const struct pattern *p = &g_array_index(gs->patterns, struct pattern, i);
+
+                run[i].next = 0;
+                run[i].min_start = 0;
+
+                if (p->literal) {
+                        if (strcmp(text, p->glob) == 0)
+                                bits[p->id / 32] |= 1u << (p->id % 32);
+                        run[i].next = DEAD;
+                        continue;
+                }
+
+                if (p->head) {
+                        if (strncmp(text, p->frags[0].str, p->frags[0].len) != 0) {
+                                run[i].next = DEAD;
+                                continue;
+                        }
+                        run[i].next = 1;
+                        run[i].min_start = p->frags[0].len;
+                }
+
+                if (run[i].next < pattern_mid_end(p))
+                        scan = true;
+        }
+
+        gsize len = 0;
+        if (scan) {
+                guint state = 0;
+                for (; text[len]; len++) {
+                        state = gs->trans[state * gs->n_classes + gs->classes[(guint8) text[len]]];
+
+                        guint s = gs->out_start[state] < gs->out_start[state + 1]
+                                ? state : gs->dict[state];
+                        for (; s; s = gs->dict[s]) {
+                                for (guint w = gs->out_start[s]; w < gs->out_start[s + 1]; w++) {
+                                        const struct waiter *wt = &gs->waiters[w];
+                                        struct progress *r = &run[wt->pattern];
+
+                                        if (r->next == wt->index && len + 1 - wt->len >= r->min_start) {
+                                                r->next++;
+                                                r->min_start = len + 1;
+                                        }
+                                }
+                        }
+                }
+        } else {
+                len = strlen(text);
+        }
+
+        for (guint i = 0; i < gs->patterns->len; i++) {
+                const struct pattern *p = &g_array_index(gs->patterns, struct pattern, i);
+
+                if (run[i].next == DEAD || run[i].next != pattern_mid_end(p))
+                        continue;
+
+                if (p->tail) {
+                        const struct fragment *f = &p->frags[p->n_frags - 1];
+                        if (len < run[i].min_start + f->len
+                            || memcmp(text + len - f->len, f->str, f->len) != 0)
+                                continue;
+                }
+
+                bits[p->id / 32] |= 1u << (p->id % 32);
+        }
+
+        g_free(run);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,78 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_GLOBSET_H
+#define DUNST_GLOBSET_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+/**
+ * The amount of guint32 words a bitset for `n` ids needs
+ */
+#define GLOBSET_WORDS(n) (((n) + 31) / 32)
+
+/**
+ * Check if the bit of the given id is set in the bitset
+ */
+#define GLOBSET_TEST(bits, id) (((bits)[(id) / 32] >> ((id) % 32)) & 1)
+
+/**
+ * A set of glob patterns, which get matched against a text all at once
+ *
+ * The literal fragments between the stars of all patterns get merged into
+ * a single Aho-Corasick automaton, so that a text has to be scanned only
+ * once to find out which of the patterns match.
+ */
+typedef struct _globset globset;
+
+/**
+ * Create a new, empty set
+ */
+globset *globset_new(void);
+
+/**
+ * Free the set
+ *
+ * @param gs (nullable) The set to free
+ */
+void globset_free(globset *gs);
+
+/**
+ * Add a pattern to the set
+ *
+ * Only '*' is supported as a wildcard. Patterns with '?', brackets or
+ * escapes have to be matched with fnmatch() instead.
+ *
+ * @param gs A set, which was not built yet
+ * @param pattern The glob pattern
+ * @param id The bit to set in the result of globset_match() if
+ *           `pattern` matches
+ *
+ * @return false, if the pattern is not supported and was not added
+ */
+bool globset_add(globset *gs, const char *pattern, guint id);
+
+/**
+ * Build the automaton. No patterns can be added afterwards.
+ */
+void globset_build(globset *gs);
+
+/**
+ * @return the amount of patterns in the set
+ */
+guint globset_size(const globset *gs);
+
+/**
+ * Match all patterns of the set against the text in a single pass
+ *
+ * Equivalent to calling fnmatch(pattern, text, 0) for each pattern.
+ *
+ * @param gs A built set
+ * @param text (nullable) The text to match, NULL is handled as ""
+ * @param bits A bitset with GLOBSET_WORDS() words for the highest id.
+ *             The bits of all matching patterns get set, no bits are
+ *             cleared.
+ */
+void globset_match(const globset *gs, const char *text, guint32 *bits);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,175 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "heap.h"
+
+#include <assert.h>
+#include <glib.h>
+
+#define PARENT(i) (((i) - 1) / 2)
+#define LEFT(i)   (2 * (i) + 1)
+
+/**
+ * Place an item at the given position and notify it about the move
+ */
+static void heap_set(heap *h, guint index, gpointer item)
+{
+        h->items->pdata[index] = item;
+        if (h->set_index)
+                h->set_index(item, index);
+}
+
+/**
+ * Move the item at index up until its parent is smaller
+ *
+ * @return the final position of the item
+ */
+static guint heap_sift_up(heap *h, guint index)
+{
+        gpointer item = h->items->pdata[index];
+
+        while (index > 0) {
+                gpointer parent = h->items->pdata[PARENT(index)];
+                if (h->cmp(parent, item) <= 0)
+                        break;
+                heap_set(h, index, parent);
+                index = PARENT(index);
+        }
+        heap_set(h, index, item);
+
+        return index;
+}
+
+/**
+ * Move the item at index down until both children are larger
+ */
+static void heap_sift_down(heap *h, guint index)
+{
+        gpointer item = h->items->pdata[index];
+        guint len = h->items->len;
+
+        while (LEFT(index) < len) {
+                guint child = LEFT(index);
+                if (child + 1 < len
+                    && h->cmp(h->items->pdata[child + 1], h->items->pdata[child]) < 0)
+                        child++;
+
+                if (h->cmp(item, h->items->pdata[child]) <= 0)
+                        break;
+
+                heap_set(h, index, h->items->pdata[child]);
+                index = child;
+        }
+        heap_set(h, index, item);
+}
+
+/* see heap.h */
+heap *heap_new(GCompareFunc cmp, heap_index_func set_index)
+{
+        heap *h = g_malloc(sizeof(heap));
+
+        h->items = g_ptr_array_new();
+        h->cmp = cmp;
+        h->set_index = set_index;
+
+        return h;
+}
+
+/* see heap.h */
+void heap_free(heap *h)
+{
+        if (!h)
+                return;
+
+        g_ptr_array_free(h->items, TRUE);
+        g_free(h);
+}
+
+/* see heap.h */
+guint heap_length(const heap *h)
+{
+        return h->items->len;
+}
+
+/* see heap.h */
+gpointer heap_get(const heap *h, guint index)
+{
+        assert(index < h->items->len);
+        return h->items->pdata[index];
+}
+
+/* see heap.h */
+gpointer heap_peek(const heap *h)
+{
+        return h->items->len > 0 ? h->items->pdata[0] : NULL;
+}
+
+/* see heap.h */
+void heap_push(heap *h, gpointer item)
+{
+        g_ptr_array_add(h->items, item);
+        heap_sift_up(h, h->items->len - 1);
+}
+
+/* see heap.h */
+gpointer heap_pop(heap *h)
+{
+        if (h->items->len == 0)
+                return NULL;
+
+        return heap_remove(h, 0);
+}
+
+/* see heap.h */
+gpointer heap_remove(heap *h, guint index)
+{
+        assert(index < h->items->len);
+
+        gpointer item = h->items->pdata[index];
+        gpointer last = g_ptr_array_remove_index(h->items, h->items->len - 1);
+
+        if (index < h->items->len) {
+                h->items->pdata[index] = last;
+                heap_update(h, index);
+        }
+
+        return item;
+}
+
+/* see heap.h */
+void heap_update(heap *h, guint index)
+{
+        assert(index < h->items->len);
+
+        if (heap_sift_up(h, index) == index)
+                heap_sift_down(h, index);
+}
+
+/* see heap.h */
+void heap_merge(heap *h, GPtrArray *items)
+{
+        guint len = h->items->len;
+
+        for (guint i = 0; i < items->len; i++)
+                g_ptr_array_add(h->items, items->pdata[i]);
+
+        /* sifting up each item costs O(k log n), rebuilding the heap O(n + k) */
+        if (items->len * 8 < len) {
+                for (guint i = len; i < h->items->len; i++)
+                        heap_sift_up(h, i);
+        } else {
+                heap_rebuild(h);
+        }
+}
+
+/* see heap.h */
+void heap_rebuild(heap *h)
+{
+        for (guint i = h->items->len / 2; i > 0; i--)
+                heap_sift_down(h, i - 1);
+
+        /* leaves never get sifted, tell them their position explicitly */
+        if (h->set_index)
+                for (guint i = h->items->len / 2; i < h->items->len; i++)
+                        h->set_index(h->items->pdata[i], i);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
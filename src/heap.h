@@ -0,0 +1,107 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_HEAP_H
+#define DUNST_HEAP_H
+
+#include <glib.h>
+
+/**
+ * Callback to inform an item about its current position in the heap
+ *
+ * @param item The item, which got moved
+ * @param index The new position of `item`
+ */
+typedef void (*heap_index_func)(gpointer item, guint index);
+
+/**
+ * A binary min-heap of arbitrary pointers
+ *
+ * The smallest item according to #cmp is always at index 0.
+ */
+typedef struct _heap {
+        GPtrArray *items;          /**< the items in heap order */
+        GCompareFunc cmp;          /**< the order of the items */
+        heap_index_func set_index; /**< (nullable) notified on each move of an item */
+} heap;
+
+/**
+ * Create a new, empty heap
+ *
+ * @param cmp The function to order the items
+ * @param set_index (nullable) The function to track the positions of the
+ *                  items. Required to use heap_remove() and heap_update().
+ */
+heap *heap_new(GCompareFunc cmp, heap_index_func set_index);
+
+/**
+ * Free the heap. The items themselves are not freed.
+ *
+ * @param h (nullable) The heap to free
+ */
+void heap_free(heap *h);
+
+/**
+ * @return the amount of items in the heap
+ */
+guint heap_length(const heap *h);
+
+/**
+ * Get the item at the given position of the heap
+ *
+ * Iterating over all indices visits all items in no particular order.
+ *
+ * @param h The heap
+ * @param index A position smaller than heap_length()
+ */
+gpointer heap_get(const heap *h, guint index);
+
+/**
+ * @return the smallest item or NULL, if the heap is empty
+ */
+gpointer heap_peek(const heap *h);
+
+/**
+ * Insert an item into the heap in `O(log n)`
+ */
+void heap_push(heap *h, gpointer item);
+
+/**
+ * Remove the smallest item from the heap in `O(log n)`
+ *
+ * @return the smallest item or NULL, if the heap is empty
+ */
+gpointer heap_pop(heap *h);
+
+/**
+ * Remove the item at the given position from the heap in `O(log n)`
+ *
+ * @param h The heap
+ * @param index The position of the item, as passed to #heap_index_func
+ *
+ * @return the removed item
+ */
+gpointer heap_remove(heap *h, guint index);
+
+/**
+ * Restore the heap order after the sort key of a single item changed
+ *
+ * @param h The heap
+ * @param index The position of the changed item
+ */
+void heap_update(heap *h, guint index);
+
+/**
+ * Insert all items of the array into the heap at once in `O(n + k)`
+ *
+ * @param h The heap
+ * @param items The items to insert. The array itself is not modified.
+ */
+void heap_merge(heap *h, GPtrArray *items);
+
+/**
+ * Restore the heap order after the sort keys of arbitrary items changed
+ * in `O(n)`
+ */
+void heap_rebuild(heap *h);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,741 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "icon.h"
+
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "log.h"
+#include "notification.h"
+#include "settings.h"
+
+static cairo_user_data_key_t icon_bytes_key;
+
+static bool does_file_exist(const char *filename)
+{
+        return (access(filename, F_OK) != -1);
+}
+
+static bool is_readable_file(const char *filename)
+{
+        return (access(filename, R_OK) != -1);
+}
+
+/*
+ * Multiply a color channel with the alpha value, rounding like c * a / 255.
+ */
+static inline guint8 premultiply(guint8 c, guint8 a)
+{
+        guint t = c * a + 0x80;
+        return (t + (t >> 8)) >> 8;
+}
+
+/*
+ * Convert a row of RGB pixels to ARGB32.
+ */
+static void icon_row_rgb_to_argb32(const guchar *src, guint32 *dst, int width)
+{
+        for (int x = 0; x < width; x++, src += 3)
+                dst[x] = 0xff000000u
+                       | (guint32) src[0] << 16
+                       | (guint32) src[1] << 8
+                       | src[2];
+}
+
+/*
+ * Convert a row of RGBA pixels to premultiplied ARGB32.
+ */
+static void icon_row_rgba_to_argb32(const guchar *src, guint32 *dst, int width)
+{
+        int x = 0;
+
+#ifdef __SSE2__
+        /* Premultiply four pixels at once, as 16 bit lanes */
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(0x80);
+        const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+        for (; x + 4 <= width; x += 4, src += 16) {
+                __m128i px = _mm_loadu_si128((const __m128i *) src);
+                __m128i halves[2] = {
+                        _mm_unpacklo_epi8(px, zero),
+                        _mm_unpackhi_epi8(px, zero),
+                };
+
+                for (int i = 0; i < 2; i++) {
+                        __m128i c = halves[i];
+                        __m128i a = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+                        a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+                        __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), round);
+                        t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+
+                        /* keep the alpha itself and swap R and B */
+                        t = _mm_or_si128(_mm_andnot_si128(alpha_mask, t),
+                                         _mm_and_si128(alpha_mask, c));
+                        t = _mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2));
+                        halves[i] = _mm_shufflehi_epi16(t, _MM_SHUFFLE(3, 0, 1, 2));
+                }
+
+                _mm_storeu_si128((__m128i *) (dst + x),
+                                 _mm_packus_epi16(halves[0], halves[1]));
+        }
+#endif
+
+        for (; x < width; x++, src += 4) {
+                guint8 a = src[3];
+                dst[x] = (guint32) a << 24
+                       | (guint32) premultiply(src[0], a) << 16
+                       | (guint32) premultiply(src[1], a) << 8
+                       | premultiply(src[2], a);
+        }
+}
+
+/*
+ * Convert the pixels of a pixbuf to premultiplied ARGB32 in native byte
+ * order, which is the pixel format of CAIRO_FORMAT_ARGB32 surfaces.
+ */
+static void icon_pixbuf_to_argb32(GdkPixbuf *pixbuf, guchar *dst, int dst_stride)
+{
+        int width = gdk_pixbuf_get_width(pixbuf);
+        int height = gdk_pixbuf_get_height(pixbuf);
+        int channels = gdk_pixbuf_get_n_channels(pixbuf);
+        int stride = gdk_pixbuf_get_rowstride(pixbuf);
+        bool has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+        const guchar *src = gdk_pixbuf_get_pixels(pixbuf);
+
+        for (int y = 0; y < height; y++) {
+                const guchar *s = src + y * stride;
+                guint32 *d = (guint32 *) (dst + y * dst_stride);
+
+                if (has_alpha && channels == 4)
+                        icon_row_rgba_to_argb32(s, d, width);
+                else
+                        icon_row_rgb_to_argb32(s, d, width);
+        }
+}
+
+/*
+ * Copy the pixbuf into a new image surface.
+ */
+static cairo_surface_t *gdk_pixbuf_to_cairo_surface(GdkPixbuf *pixbuf)
+{
+        cairo_surface_t *icon_surface = cairo_image_surface_create(
+                        CAIRO_FORMAT_ARGB32,
+                        gdk_pixbuf_get_width(pixbuf),
+                        gdk_pixbuf_get_height(pixbuf));
+
+        if (cairo_surface_status(icon_surface) != CAIRO_STATUS_SUCCESS)
+                return icon_surface;
+
+        cairo_surface_flush(icon_surface);
+        icon_pixbuf_to_argb32(pixbuf,
+                              cairo_image_surface_get_data(icon_surface),
+                              cairo_image_surface_get_stride(icon_surface));
+        cairo_surface_mark_dirty(icon_surface);
+
+        return icon_surface;
+}
+
+static GdkPixbuf *get_pixbuf_from_file(const char *icon_path)
+{
+        GdkPixbuf *pixbuf = NULL;
+        if (is_readable_file(icon_path)) {
+                GError *error = NULL;
+                pixbuf = gdk_pixbuf_new_from_file(icon_path, &error);
+                if (pixbuf == NULL)
+                        g_free(error);
+        }
+        return pixbuf;
+}
+
+/**
+ * A file found in one of the directories of the icon_path
+ */
+struct icon_index_entry {
+        char *path;
+        guint folder; /**< the position of its directory in the icon_path */
+        bool svg;
+        struct icon_index_entry *next; /**< the file of the same name in a later directory */
+};
+
+static struct {
+        GHashTable *names;      /**< icon name -> struct icon_index_entry */
+        char *icon_path;        /**< the settings.icon_path the index was built from */
+        GPtrArray *monitors;    /**< GFileMonitor for each directory of the icon_path */
+} icon_index = { NULL, NULL, NULL };
+
+static void icon_index_entry_free(gpointer data)
+{
+        struct icon_index_entry *e = data;
+
+        while (e) {
+                struct icon_index_entry *next = e->next;
+                g_free(e->path);
+                g_free(e);
+                e = next;
+        }
+}
+
+/*
+ * Forget the contents of the directories, as one of them changed.
+ * Cached icons may have been loaded from the changed files, so drop
+ * them as well.
+ */
+static void icon_index_changed(GFileMonitor *monitor,
+                               GFile *file,
+                               GFile *other_file,
+                               GFileMonitorEvent event_type,
+                               gpointer user_data)
+{
+        if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+            || event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+                return;
+
+        if (icon_index.names)
+                g_hash_table_destroy(icon_index.names);
+        icon_index.names = NULL;
+
+        icon_cache_clear();
+}
+
+static void icon_index_free(void)
+{
+        if (icon_index.monitors)
+                g_ptr_array_free(icon_index.monitors, true);
+        icon_index.monitors = NULL;
+
+        if (icon_index.names)
+                g_hash_table_destroy(icon_index.names);
+        icon_index.names = NULL;
+
+        g_free(icon_index.icon_path);
+        icon_index.icon_path = NULL;
+}
+
+/*
+ * Watch the directories of settings.icon_path for changes.
+ */
+static void icon_index_watch(char **folders)
+{
+        icon_index.monitors = g_ptr_array_new_with_free_func(g_object_unref);
+
+        for (int i = 0; folders[i]; i++) {
+                GFile *dir = g_file_new_for_path(folders[i]);
+                GFileMonitor *monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_NONE, NULL, NULL);
+                g_object_unref(dir);
+
+                if (!monitor)
+                        continue;
+
+                g_signal_connect(monitor, "changed", G_CALLBACK(icon_index_changed), NULL);
+                g_ptr_array_add(icon_index.monitors, monitor);
+        }
+}
+
+/*
+ * List the svg and png files in the directories of settings.icon_path.
+ *
+ * Every name maps to a list of files, one per directory in the order of
+ * the icon_path. Within the same directory, svg files take precedence over
+ * png files.
+ */
+static void icon_index_build(char **folders)
+{
+        icon_index.names = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                 g_free, icon_index_entry_free);
+
+        for (guint i = 0; folders[i]; i++) {
+                GDir *dir = g_dir_open(folders[i], 0, NULL);
+                if (!dir)
+                        continue;
+
+                const char *file;
+                while ((file = g_dir_read_name(dir))) {
+                        bool svg = g_str_has_suffix(file, ".svg");
+                        if (!svg && !g_str_has_suffix(file, ".png"))
+                                continue;
+
+                        char *name = g_strndup(file, strlen(file) - 4);
+                        struct icon_index_entry *head = g_hash_table_lookup(icon_index.names, name);
+                        struct icon_index_entry *last = head;
+
+                        while (last && last->next)
+                                last = last->next;
+
+                        if (last && last->folder == i) {
+                                if (svg && !last->svg) {
+                                        g_free(last->path);
+                                        last->path = g_strconcat(folders[i], "/", file, NULL);
+                                        last->svg = true;
+                                }
+                                g_free(name);
+                                continue;
+                        }
+
+                        struct icon_index_entry *e = g_malloc(sizeof(struct icon_index_entry));
+                        e->path = g_strconcat(folders[i], "/", file, NULL);
+                        e->folder = i;
+                        e->svg = svg;
+                        e->next = NULL;
+
+                        if (last) {
+                                last->next = e;
+                                g_free(name);
+                        } else {
+                                g_hash_table_insert(icon_index.names, name, e);
+                        }
+                }
+
+                g_dir_close(dir);
+        }
+}
+
+/*
+ * Find the files of the icon with the given name in settings.icon_path.
+ *
+ * @return the file in the first directory, followed by the ones in later
+ *         directories, owned by the index
+ * @return NULL, if no directory has an icon with this name
+ */
+static const struct icon_index_entry *icon_index_lookup(const char *name)
+{
+        if (g_strcmp0(icon_index.icon_path, settings.icon_path) != 0)
+                icon_index_free();
+
+        if (!icon_index.names) {
+                char **folders = g_strsplit(settings.icon_path ? settings.icon_path : "", ":", -1);
+
+                if (!icon_index.icon_path) {
+                        icon_index.icon_path = g_strdup(settings.icon_path);
+                        icon_index_watch(folders);
+                }
+                icon_index_build(folders);
+
+                g_strfreev(folders);
+        }
+
+        return g_hash_table_lookup(icon_index.names, name);
+}
+
+static GdkPixbuf *get_pixbuf_from_path(const char *icon_path)
+{
+        GdkPixbuf *pixbuf = NULL;
+        gchar *uri_path = NULL;
+        if (strlen(icon_path) > 0) {
+                if (g_str_has_prefix(icon_path, "file://")) {
+                        uri_path = g_filename_from_uri(icon_path, NULL, NULL);
+                        if (uri_path != NULL) {
+                                icon_path = uri_path;
+                        }
+                }
+                /* absolute path? */
+                if (icon_path[0] == '/' || icon_path[0] == '~') {
+                        pixbuf = get_pixbuf_from_file(icon_path);
+                }
+                /* search in icon_path */
+                if (pixbuf == NULL && !strchr(icon_path, '/')) {
+                        /* a file, which fails to load, falls back to the later directories */
+                        for (const struct icon_index_entry *e = icon_index_lookup(icon_path);
+                             e && !pixbuf; e = e->next)
+                                pixbuf = get_pixbuf_from_file(e->path);
+                } else if (pixbuf == NULL) {
+                        char *start = settings.icon_path,
+                             *end, *current_folder, *maybe_icon_path;
+                        do {
+                                end = strchr(start, ':');
+                                if (end == NULL) end = strchr(settings.icon_path, '\0'); /* end = end of string */
+
+                                current_folder = g_strndup(start, end - start);
+                                /* try svg */
+                                maybe_icon_path = g_strconcat(current_folder, "/", icon_path, ".svg", NULL);
+                                if (!does_file_exist(maybe_icon_path)) {
+                                        g_free(maybe_icon_path);
+                                        /* fallback to png */
+                                        maybe_icon_path = g_strconcat(current_folder, "/", icon_path, ".png", NULL);
+                                }
+                                g_free(current_folder);
+
+                                pixbuf = get_pixbuf_from_file(maybe_icon_path);
+                                g_free(maybe_icon_path);
+                                if (pixbuf != NULL) {
+                                        g_free(uri_path);
+                                        return pixbuf;
+                                }
+
+                                start = end + 1;
+                        } while (*(end) != '\0');
+                }
+                if (pixbuf == NULL) {
+                        LOG_W("Could not load icon: '%s'", icon_path);
+                }
+                if (uri_path != NULL) {
+                        g_free(uri_path);
+                }
+        }
+        return pixbuf;
+}
+
+static void pixbuf_release_bytes(guchar *pixels, gpointer bytes)
+{
+        g_bytes_unref(bytes);
+}
+
+/*
+ * Wrap the pixels of the raw image into a pixbuf without copying them.
+ * The pixbuf holds its own reference to the pixels, so it may outlive
+ * the raw image.
+ */
+static GdkPixbuf *get_pixbuf_from_raw_image(const RawImage *raw_image)
+{
+        GdkPixbuf *pixbuf = NULL;
+
+        pixbuf = gdk_pixbuf_new_from_data(raw_image->data,
+                                          GDK_COLORSPACE_RGB,
+                                          raw_image->has_alpha,
+                                          raw_image->bits_per_sample,
+                                          raw_image->width,
+                                          raw_image->height,
+                                          raw_image->rowstride,
+                                          pixbuf_release_bytes,
+                                          g_bytes_ref(raw_image->bytes));
+
+        return pixbuf;
+}
+
+/* see icon.h */
+GdkPixbuf *icon_pixbuf_scale(GdkPixbuf *pixbuf, int max_size)
+{
+        int w = gdk_pixbuf_get_width(pixbuf);
+        int h = gdk_pixbuf_get_height(pixbuf);
+        int larger = w > h ? w : h;
+
+        if (!max_size || larger <= max_size)
+                return pixbuf;
+
+        GdkPixbuf *scaled;
+        if (w >= h) {
+                scaled = gdk_pixbuf_scale_simple(pixbuf,
+                                max_size,
+                                (int) ((double) max_size / w * h),
+                                GDK_INTERP_BILINEAR);
+        } else {
+                scaled = gdk_pixbuf_scale_simple(pixbuf,
+                                (int) ((double) max_size / h * w),
+                                max_size,
+                                GDK_INTERP_BILINEAR);
+        }
+        g_object_unref(pixbuf);
+
+        return scaled;
+}
+
+/*
+ * Create a raw image holding the pixels of the pixbuf in the cairo format.
+ */
+static RawImage *icon_raw_image_from_pixbuf(GdkPixbuf *pixbuf)
+{
+        RawImage *image = g_malloc(sizeof(RawImage));
+
+        image->width = gdk_pixbuf_get_width(pixbuf);
+        image->height = gdk_pixbuf_get_height(pixbuf);
+        image->rowstride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, image->width);
+        image->has_alpha = true;
+        image->bits_per_sample = 8;
+        image->n_channels = 4;
+        image->argb32 = true;
+
+        gsize size = (gsize) image->rowstride * image->height;
+        guchar *data = g_malloc(size);
+        icon_pixbuf_to_argb32(pixbuf, data, image->rowstride);
+
+        image->bytes = g_bytes_new_take(data, size);
+        image->data = data;
+
+        return image;
+}
+
+/* see icon.h */
+RawImage *icon_ingest_raw_image(RawImage *raw, int max_size)
+{
+        if (!raw)
+                return NULL;
+
+        GdkPixbuf *pixbuf = get_pixbuf_from_raw_image(raw);
+        rawimage_free(raw);
+
+        if (!pixbuf)
+                return NULL;
+
+        pixbuf = icon_pixbuf_scale(pixbuf, max_size);
+        RawImage *image = icon_raw_image_from_pixbuf(pixbuf);
+        g_object_unref(pixbuf);
+
+        return image;
+}
+
+/* see icon.h */
+cairo_surface_t *icon_get_for_raw_image(const RawImage *raw, int max_size)
+{
+        if (raw->argb32) {
+                cairo_surface_t *surface = cairo_image_surface_create_for_data(
+                                (unsigned char *) raw->data,
+                                CAIRO_FORMAT_ARGB32,
+                                raw->width,
+                                raw->height,
+                                raw->rowstride);
+
+                /* the surface keeps the pixels alive on its own */
+                cairo_surface_set_user_data(surface, &icon_bytes_key,
+                                            g_bytes_ref(raw->bytes),
+                                            (cairo_destroy_func_t) g_bytes_unref);
+                return surface;
+        }
+
+        GdkPixbuf *pixbuf = get_pixbuf_from_raw_image(raw);
+        if (!pixbuf)
+                return NULL;
+
+        pixbuf = icon_pixbuf_scale(pixbuf, max_size);
+        cairo_surface_t *surface = gdk_pixbuf_to_cairo_surface(pixbuf);
+        g_object_unref(pixbuf);
+
+        return surface;
+}
+
+/*
+ * Load, scale and convert the icon, bypassing the cache.
+ */
+static cairo_surface_t *icon_load_for_path(const char *path, int max_size)
+{
+        GdkPixbuf *pixbuf = get_pixbuf_from_path(path);
+        if (!pixbuf)
+                return NULL;
+
+        pixbuf = icon_pixbuf_scale(pixbuf, max_size);
+        cairo_surface_t *surface = gdk_pixbuf_to_cairo_surface(pixbuf);
+        g_object_unref(pixbuf);
+
+        return surface;
+}
+
+/**
+ * An icon loaded by icon_get_for_path()
+ */
+struct icon_cache_entry {
+        char *path;               /**< the path or name the icon got requested with */
+        int max_size;
+        cairo_surface_t *surface; /**< NULL, if the icon couldn't be loaded */
+        gsize bytes;              /**< the size of the pixels of the surface */
+        time_t mtime;             /**< the modification time of the file, for file paths */
+        off_t size;               /**< the size of the file, for file paths */
+        GList link;               /**< the position in the LRU list */
+};
+
+static struct {
+        GHashTable *entries;      /**< struct icon_cache_entry, keyed by itself */
+        GQueue lru;               /**< the most recently used entry first */
+        gsize bytes;
+        char *icon_path;          /**< the settings.icon_path the entries were found in */
+} icon_cache = { NULL, G_QUEUE_INIT, 0, NULL };
+
+static guint icon_cache_entry_hash(gconstpointer key)
+{
+        const struct icon_cache_entry *e = key;
+        return g_str_hash(e->path) * 31 + e->max_size;
+}
+
+static gboolean icon_cache_entry_equal(gconstpointer a, gconstpointer b)
+{
+        const struct icon_cache_entry *e1 = a, *e2 = b;
+        return e1->max_size == e2->max_size && strcmp(e1->path, e2->path) == 0;
+}
+
+static void icon_cache_entry_free(gpointer data)
+{
+        struct icon_cache_entry *e = data;
+
+        g_queue_unlink(&icon_cache.lru, &e->link);
+        icon_cache.bytes -= e->bytes;
+
+        if (e->surface)
+                cairo_surface_destroy(e->surface);
+        g_free(e->path);
+        g_free(e);
+}
+
+/*
+ * Drop the least recently used entries until the cache has room for
+ * another entry of the given size.
+ */
+static void icon_cache_evict(gsize bytes)
+{
+        gsize max_bytes = (gsize) settings.icon_cache_size * 1024;
+
+        while (icon_cache.lru.tail
+               && (icon_cache.lru.length >= (guint) settings.icon_cache_entries
+                   || icon_cache.bytes + bytes > max_bytes))
+                g_hash_table_remove(icon_cache.entries, icon_cache.lru.tail->data);
+}
+
+/*
+ * Icons given by an absolute path or file:// URI are loaded from that file
+ * directly, which may get rewritten behind the back of the cache.
+ */
+static bool icon_path_is_file(const char *path)
+{
+        return path[0] == '/' || path[0] == '~' || g_str_has_prefix(path, "file://");
+}
+
+static bool icon_file_stat(const char *path, struct stat *st)
+{
+        char *uri_path = NULL;
+        if (g_str_has_prefix(path, "file://"))
+                path = uri_path = g_filename_from_uri(path, NULL, NULL);
+
+        bool exists = path && stat(path, st) == 0;
+        g_free(uri_path);
+
+        return exists;
+}
+
+/* see icon.h */
+void icon_teardown(void)
+{
+        icon_cache_clear();
+        icon_index_free();
+}
+
+/* see icon.h */
+void icon_cache_clear(void)
+{
+        if (icon_cache.entries)
+                g_hash_table_destroy(icon_cache.entries);
+        icon_cache.entries = NULL;
+
+        g_free(icon_cache.icon_path);
+        icon_cache.icon_path = NULL;
+}
+
+/**
+ * The state of the file of an icon given by a file path
+ */
+struct icon_file {
+        bool is_file;   /**< the icon is given by a file path instead of a name */
+        bool exists;
+        struct stat st;
+};
+
+/*
+ * Find the cache entry of an icon, which is still valid. The entry of an
+ * icon, whose file changed, gets dropped.
+ *
+ * @param file (out) the state of the file of the icon
+ */
+static struct icon_cache_entry *icon_cache_lookup(const char *path, int max_size, struct icon_file *file)
+{
+        /* names got resolved against the old icon_path */
+        if (g_strcmp0(icon_cache.icon_path, settings.icon_path) != 0)
+                icon_cache_clear();
+
+        file->is_file = icon_path_is_file(path);
+        file->exists = file->is_file && icon_file_stat(path, &file->st);
+
+        if (!icon_cache.entries)
+                return NULL;
+
+        struct icon_cache_entry key = { .path = (char *) path, .max_size = max_size };
+        struct icon_cache_entry *e = g_hash_table_lookup(icon_cache.entries, &key);
+
+        if (e && file->is_file
+            && (!file->exists
+                || e->mtime != file->st.st_mtime
+                || e->size != file->st.st_size)) {
+                g_hash_table_remove(icon_cache.entries, e);
+                e = NULL;
+        }
+
+        return e;
+}
+
+/* see icon.h */
+bool icon_is_current(const char *path, int max_size, const cairo_surface_t *surface)
+{
+        if (settings.icon_cache_entries <= 0)
+                return false;
+
+        struct icon_file file;
+        const struct icon_cache_entry *e = icon_cache_lookup(path, max_size, &file);
+
+        return e && e->surface == surface;
+}
+
+/* see icon.h */
+cairo_surface_t *icon_get_for_path(const char *path, int max_size)
+{
+        if (settings.icon_cache_entries <= 0)
+                return icon_load_for_path(path, max_size);
+
+        struct icon_file file;
+        struct icon_cache_entry *e = icon_cache_lookup(path, max_size, &file);
+
+        if (e) {
+                g_queue_unlink(&icon_cache.lru, &e->link);
+                g_queue_push_head_link(&icon_cache.lru, &e->link);
+                return e->surface ? cairo_surface_reference(e->surface) : NULL;
+        }
+
+        cairo_surface_t *surface = icon_load_for_path(path, max_size);
+        gsize bytes = 0;
+
+        /* the file may show up any time, don't remember it missing */
+        if (file.is_file && (!surface || !file.exists))
+                return surface;
+
+        if (surface) {
+                if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+                        return surface;
+
+                bytes = (gsize) cairo_image_surface_get_stride(surface)
+                      * cairo_image_surface_get_height(surface);
+                if (bytes > (gsize) settings.icon_cache_size * 1024)
+                        return surface;
+        }
+
+        if (!icon_cache.entries) {
+                icon_cache.entries = g_hash_table_new_full(icon_cache_entry_hash,
+                                                           icon_cache_entry_equal,
+                                                           NULL,
+                                                           icon_cache_entry_free);
+                icon_cache.icon_path = g_strdup(settings.icon_path);
+        }
+
+        icon_cache_evict(bytes);
+
+        e = g_malloc0(sizeof(struct icon_cache_entry));
+        e->path = g_strdup(path);
+        e->max_size = max_size;
+        e->surface = surface ? cairo_surface_reference(surface) : NULL;
+        e->bytes = bytes;
+        if (file.is_file) {
+                e->mtime = file.st.st_mtime;
+                e->size = file.st.st_size;
+        }
+        e->link.data = e;
+
+        g_queue_push_head_link(&icon_cache.lru, &e->link);
+        icon_cache.bytes += bytes;
+        g_hash_table_add(icon_cache.entries, e);
+
+        return surface;
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
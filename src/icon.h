@@ -0,0 +1,90 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_ICON_H
+#define DUNST_ICON_H
+
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "notification.h"
+
+/**
+ * Scale the pixbuf down, so that neither side is larger than max_size
+ *
+ * The aspect ratio is kept. Smaller pixbufs are left as they are.
+ *
+ * @param pixbuf (transfer full) The pixbuf to scale
+ * @param max_size The maximum size, 0 for no limit
+ *
+ * @return (transfer full) the scaled pixbuf
+ */
+GdkPixbuf *icon_pixbuf_scale(GdkPixbuf *pixbuf, int max_size);
+
+/**
+ * Prepare the raw image of a notification for rendering
+ *
+ * The image gets scaled down to max_size and converted to premultiplied
+ * ARGB32, so that it can be painted by cairo without any further
+ * conversion. The original pixels are released.
+ *
+ * @param raw (nullable) (transfer full) The raw image as received
+ * @param max_size The maximum size of the icon, 0 for no limit
+ *
+ * @return (transfer full) the converted image
+ * @return NULL, if the image data is not supported
+ */
+RawImage *icon_ingest_raw_image(RawImage *raw, int max_size);
+
+/**
+ * Get a surface to paint the raw image of a notification
+ *
+ * Images prepared by icon_ingest_raw_image() are painted from their own
+ * pixels without copying them, all others get converted.
+ *
+ * @return (transfer full) the surface, which may be in an error state
+ * @return NULL, if the image can't be converted
+ */
+cairo_surface_t *icon_get_for_raw_image(const RawImage *raw, int max_size);
+
+/**
+ * Load an icon by its path or name
+ *
+ * Names get looked up in an index of the svg and png files in the
+ * directories of `settings.icon_path`, which is kept up to date by watching
+ * the directories for changes. The loaded icons are kept
+ * in a cache, which is limited by `settings.icon_cache_entries` and
+ * `settings.icon_cache_size` and dropped when the icon_path changes. Icons
+ * given by a file path are reloaded when the file changes. Names, which
+ * couldn't be found, are cached as well, missing files aren't.
+ *
+ * @param path The path, file:// URI or name of the icon
+ * @param max_size The maximum size of the icon, 0 for no limit
+ *
+ * @return (transfer full) the surface, which may be in an error state
+ * @return NULL, if no icon could be loaded
+ */
+cairo_surface_t *icon_get_for_path(const char *path, int max_size);
+
+/**
+ * Check, if icon_get_for_path() would still return the given surface,
+ * without loading the icon.
+ *
+ * Icons, which aren't cached, count as changed.
+ *
+ * @param path The path, file:// URI or name of the icon
+ * @param max_size The maximum size of the icon, 0 for no limit
+ * @param surface A surface returned by icon_get_for_path()
+ */
+bool icon_is_current(const char *path, int max_size, const cairo_surface_t *surface);
+
+/**
+ * Drop all icons from the cache of icon_get_for_path()
+ */
+void icon_cache_clear(void);
+
+/**
+ * Free the icon cache and the index of the icon_path directories
+ */
+void icon_teardown(void);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
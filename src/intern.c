@@ -0,0 +1,86 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "intern.h"
+
+#include <assert.h>
+#include <glib.h>
+#include <string.h>
+
+/**
+ * An interned string with its reference count
+ */
+struct atom {
+        guint refs; /**< the references given out */
+        char str[]; /**< the canonical copy of the string */
+};
+
+/** All interned strings: str -> struct atom, the keys point into the atoms */
+static GHashTable *atoms = NULL;
+
+/**
+ * @return the atom, which holds exactly the given pointer
+ */
+static struct atom *intern_lookup(const char *str)
+{
+        struct atom *a = atoms ? g_hash_table_lookup(atoms, str) : NULL;
+
+        return a && a->str == str ? a : NULL;
+}
+
+/* see intern.h */
+char *intern(const char *str)
+{
+        if (!str)
+                return NULL;
+
+        if (!atoms)
+                atoms = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+        struct atom *a = g_hash_table_lookup(atoms, str);
+
+        if (!a) {
+                gsize len = strlen(str);
+
+                a = g_malloc(sizeof(struct atom) + len + 1);
+                a->refs = 0;
+                memcpy(a->str, str, len + 1);
+
+                g_hash_table_insert(atoms, a->str, a);
+        }
+
+        a->refs++;
+
+        return a->str;
+}
+
+/* see intern.h */
+char *intern_take(char *str)
+{
+        if (!str || intern_owns(str))
+                return str;
+
+        char *interned = intern(str);
+        g_free(str);
+
+        return interned;
+}
+
+/* see intern.h */
+void intern_release(const char *str)
+{
+        if (!str)
+                return;
+
+        struct atom *a = intern_lookup(str);
+        assert(a);
+
+        if (--a->refs == 0)
+                g_hash_table_remove(atoms, str);
+}
+
+/* see intern.h */
+bool intern_owns(const char *str)
+{
+        return str && intern_lookup(str);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,46 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_INTERN_H
+#define DUNST_INTERN_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+/**
+ * Get the canonical copy of a string and take a reference to it
+ *
+ * Equal strings get interned to the same pointer, so that interned strings
+ * can be compared by their address. Interned strings must not be modified.
+ *
+ * @param str (nullable) The string to intern
+ *
+ * @return (transfer full) the interned string, release it with intern_release()
+ * @return NULL, if `str` is NULL
+ */
+char *intern(const char *str);
+
+/**
+ * Intern a string and free the given one
+ *
+ * If `str` already is an interned string, the reference to it gets
+ * passed through.
+ *
+ * @param str (nullable) (transfer full) The string to intern
+ *
+ * @return (transfer full) the interned string, release it with intern_release()
+ */
+char *intern_take(char *str);
+
+/**
+ * Release a reference of an interned string
+ *
+ * @param str (nullable) The interned string
+ */
+void intern_release(const char *str);
+
+/**
+ * Check if the given pointer is an interned string
+ */
+bool intern_owns(const char *str);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
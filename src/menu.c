@@ -203,12 +203,13 @@ void context_menu(void)
              iter = iter->next) {
                 notification *n = iter->data;
 
-                if (n->urls)
+                if (notification_get_urls(n))
                         dmenu_input = string_append(dmenu_input, n->urls, "\n");
 
                 if (n->actions)
                         dmenu_input =
-                            string_append(dmenu_input, n->actions->dmenu_str,
+                            string_append(dmenu_input,
+                                          notification_get_actions_dmenu_str(n),
                                           "\n");
         }
 
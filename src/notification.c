@@ -5,7 +5,6 @@
 #include <assert.h>
 #include <errno.h>
 #include <glib.h>
-#include <libgen.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +14,8 @@
 
 #include "dbus.h"
 #include "dunst.h"
+#include "format.h"
+#include "intern.h"
 #include "log.h"
 #include "markup.h"
 #include "menu.h"
@@ -27,6 +28,11 @@
 static void notification_extract_urls(notification *n);
 static void notification_format_message(notification *n);
 static void notification_dmenu_string(notification *n);
+static bool notification_may_contain_url(const char *str);
+static void notification_pack_strings(notification *n);
+
+/** Reusable buffer to build the derived strings of a notification */
+static GString *scratch = NULL;
 
 /* see notification.h */
 const char *enum_to_string_fullscreen(enum behavior_fullscreen in)
@@ -64,7 +70,7 @@ void notification_print(notification *n)
         printf("\tframe: %s\n", n->colors[ColFrame]);
         printf("\tfullscreen: %s\n", enum_to_string_fullscreen(n->fullscreen));
         printf("\tid: %d\n", n->id);
-        if (n->urls) {
+        if (notification_get_urls(n)) {
                 char *urls = string_replace_all("\n", "\t\t\n", g_strdup(n->urls));
                 printf("\turls:\n");
                 printf("\t{\n");
@@ -81,7 +87,7 @@ void notification_print(notification *n)
                                n->actions->actions[i + 1]);
                 }
                 printf("\t}\n");
-                printf("\tactions_dmenu: %s\n", n->actions->dmenu_str);
+                printf("\tactions_dmenu: %s\n", notification_get_actions_dmenu_str(n));
         }
         printf("\tscript: %s\n", n->script);
         printf("}\n");
@@ -183,13 +189,31 @@ int notification_is_duplicate(const notification *a, const notification *b)
                 && (a->raw_icon != NULL || b->raw_icon != NULL))
                 return false;
 
-        return strcmp(a->appname, b->appname) == 0
+        /* appname and icon are interned */
+        return a->appname == b->appname
             && strcmp(a->summary, b->summary) == 0
             && strcmp(a->body,    b->body) == 0
-            && (settings.icon_position != icons_off ? strcmp(a->icon, b->icon) == 0 : 1)
+            && (settings.icon_position != icons_off ? a->icon == b->icon : 1)
             && a->urgency == b->urgency;
 }
 
+/*
+ * Hash the fields compared by notification_is_duplicate(), so that
+ * duplicates always share the same fingerprint.
+ */
+guint notification_fingerprint(const notification *n)
+{
+        guint hash = g_str_hash(n->appname);
+
+        hash = hash * 31 + g_str_hash(n->summary);
+        hash = hash * 31 + g_str_hash(n->body);
+        if (settings.icon_position != icons_off && n->icon)
+                hash = hash * 31 + g_str_hash(n->icon);
+        hash = hash * 31 + n->urgency;
+
+        return hash;
+}
+
 /*
  * Free the actions element
  * @a: (nullable): Pointer to #Actions
@@ -213,35 +237,70 @@ void rawimage_free(RawImage *i)
         if (!i)
                 return;
 
-        g_free(i->data);
+        g_bytes_unref(i->bytes);
         g_free(i);
 }
 
+/*
+ * Check if the string is stored in the arena of the notification.
+ */
+static inline bool notification_owns(const notification *n, const char *str)
+{
+        return n->arena && str >= n->arena && str < n->arena + n->arena_size;
+}
+
+/*
+ * Free a string of the notification. Strings in the arena get freed with
+ * the arena, interned strings get released.
+ */
+static void notification_free_string(const notification *n, char *str)
+{
+        if (notification_owns(n, str))
+                return;
+
+        if (intern_owns(str))
+                intern_release(str);
+        else
+                g_free(str);
+}
+
 /*
  * Free the memory used by the given notification.
  */
 void notification_free(notification *n)
 {
         assert(n != NULL);
-        g_free(n->appname);
-        g_free(n->summary);
-        g_free(n->body);
-        g_free(n->icon);
-        g_free(n->msg);
-        g_free(n->dbus_client);
-        g_free(n->category);
+
+        notification_free_string(n, n->appname);
+        notification_free_string(n, n->summary);
+        notification_free_string(n, n->body);
+        notification_free_string(n, n->icon);
+        notification_free_string(n, n->msg);
+        notification_free_string(n, n->dbus_client);
+        notification_free_string(n, n->category);
+        notification_free_string(n, n->urls);
+        notification_free_string(n, n->colors[ColFG]);
+        notification_free_string(n, n->colors[ColBG]);
+        notification_free_string(n, n->colors[ColFrame]);
+
+        g_free(n->arena);
         g_free(n->text_to_render);
-        g_free(n->urls);
-        g_free(n->colors[ColFG]);
-        g_free(n->colors[ColBG]);
-        g_free(n->colors[ColFrame]);
+        g_free(n->ttr.prefix);
 
         actions_free(n->actions);
         rawimage_free(n->raw_icon);
+        notification_release_layout(n);
 
         g_free(n);
 }
 
+/* see notification.h */
+void notification_release_layout(notification *n)
+{
+        x_layout_free(n->layout);
+        n->layout = NULL;
+}
+
 /*
  * Replace the two chars where **needle points
  * with a quoted "replacement", according to the markup settings.
@@ -312,10 +371,10 @@ notification *notification_create(void)
 void notification_init(notification *n)
 {
         /* default to empty string to avoid further NULL faults */
-        n->appname  = n->appname  ? n->appname  : g_strdup("unknown");
+        n->appname  = n->appname  ? intern_take(n->appname)  : intern("unknown");
         n->summary  = n->summary  ? n->summary  : g_strdup("");
         n->body     = n->body     ? n->body     : g_strdup("");
-        n->category = n->category ? n->category : g_strdup("");
+        n->category = n->category ? intern_take(n->category) : intern("");
 
         /* sanitize urgency */
         if (n->urgency < URG_MIN)
@@ -328,18 +387,21 @@ void notification_init(notification *n)
                 n->timeout = settings.timeouts[n->urgency];
 
         /* Icon handling */
-        if (n->icon && strlen(n->icon) <= 0)
-                g_clear_pointer(&n->icon, g_free);
+        n->icon = intern_take(n->icon);
+        if (n->icon && strlen(n->icon) <= 0) {
+                intern_release(n->icon);
+                n->icon = NULL;
+        }
         if (!n->raw_icon && !n->icon)
-                n->icon = g_strdup(settings.icons[n->urgency]);
+                n->icon = intern(settings.icons[n->urgency]);
 
         /* Color hints */
-        if (!n->colors[ColFG])
-                n->colors[ColFG] = g_strdup(xctx.colors[ColFG][n->urgency]);
-        if (!n->colors[ColBG])
-                n->colors[ColBG] = g_strdup(xctx.colors[ColBG][n->urgency]);
-        if (!n->colors[ColFrame])
-                n->colors[ColFrame] = g_strdup(xctx.colors[ColFrame][n->urgency]);
+        for (int i = 0; i < G_N_ELEMENTS(n->colors); i++) {
+                if (!n->colors[i])
+                        n->colors[i] = intern(xctx.colors[i][n->urgency]);
+                else
+                        n->colors[i] = intern_take(n->colors[i]);
+        }
 
         /* Sanitize misc hints */
         if (n->progress < 0)
@@ -348,115 +410,133 @@ void notification_init(notification *n)
         /* Process rules */
         rule_apply_all(n);
 
+        n->fingerprint = notification_fingerprint(n);
+
         /* UPDATE derived fields */
-        notification_extract_urls(n);
-        notification_dmenu_string(n);
+        n->urls_maybe = notification_may_contain_url(n->summary)
+                     || notification_may_contain_url(n->body);
         notification_format_message(n);
+
+        notification_pack_strings(n);
 }
 
-static void notification_format_message(notification *n)
+/*
+ * Move all strings owned by the notification into a single allocation,
+ * so that freeing them is a single g_free and they share cache lines.
+ *
+ * The strings mustn't change after packing, only text_to_render stays
+ * a separate allocation. The low cardinality fields (appname, category,
+ * icon and colors) are interned instead.
+ */
+static void notification_pack_strings(notification *n)
 {
-        g_clear_pointer(&n->msg, g_free);
+        char **fields[] = {
+                &n->summary,
+                &n->body,
+                &n->dbus_client,
+                &n->msg,
+        };
+        gsize lengths[G_N_ELEMENTS(fields)];
+        gsize size = 0;
+
+        if (n->arena)
+                return;
 
-        n->msg = string_replace_all("\\n", "\n", g_strdup(n->format));
+        for (int i = 0; i < G_N_ELEMENTS(fields); i++) {
+                lengths[i] = fields[i] && *fields[i] ? strlen(*fields[i]) + 1 : 0;
+                size += lengths[i];
+        }
 
-        /* replace all formatter */
-        for(char *substr = strchr(n->msg, '%');
-                  substr;
-                  substr = strchr(substr, '%')) {
+        if (size == 0)
+                return;
 
-                char pg[16];
-                char *icon_tmp;
+        n->arena = g_malloc(size);
+        n->arena_size = size;
 
-                switch(substr[1]) {
-                case 'a':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->appname,
-                                MARKUP_NO);
-                        break;
-                case 's':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->summary,
-                                n->markup);
-                        break;
-                case 'b':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->body,
-                                n->markup);
-                        break;
-                case 'I':
-                        icon_tmp = g_strdup(n->icon);
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                icon_tmp ? basename(icon_tmp) : "",
-                                MARKUP_NO);
-                        g_free(icon_tmp);
-                        break;
-                case 'i':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->icon ? n->icon : "",
-                                MARKUP_NO);
-                        break;
-                case 'p':
-                        if (n->progress != -1)
-                                sprintf(pg, "[%3d%%]", n->progress);
-
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->progress != -1 ? pg : "",
-                                MARKUP_NO);
-                        break;
-                case 'n':
-                        if (n->progress != -1)
-                                sprintf(pg, "%d", n->progress);
-
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->progress != -1 ? pg : "",
-                                MARKUP_NO);
-                        break;
-                case '%':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                "%",
-                                MARKUP_NO);
-                        break;
-                case '\0':
-                        LOG_W("format_string has trailing %% character. "
-                              "To escape it use %%%%.");
-                        break;
-                default:
-                        LOG_W("format_string %%%c is unknown.", substr[1]);
-                        // shift substr pointer forward,
-                        // as we can't interpret the format string
-                        substr++;
+        char *pos = n->arena;
+        for (int i = 0; i < G_N_ELEMENTS(fields); i++) {
+                if (lengths[i] == 0)
+                        continue;
+
+                memcpy(pos, *fields[i], lengths[i]);
+                g_free(*fields[i]);
+                *fields[i] = pos;
+                pos += lengths[i];
+        }
+}
+
+/*
+ * Get the scratch buffer emptied for building a new string.
+ */
+static GString *notification_scratch(void)
+{
+        if (!scratch)
+                scratch = g_string_sized_new(256);
+
+        return g_string_truncate(scratch, 0);
+}
+
+static void notification_format_message(notification *n)
+{
+        g_clear_pointer(&n->msg, g_free);
+
+        n->msg = format_render(format_compile(n->format), n);
+}
+
+/*
+ * Cheap check if the string might contain anything extract_urls(),
+ * markup_strip_a() or markup_strip_img() would find.
+ *
+ * False positives are possible, false negatives aren't.
+ */
+static bool notification_may_contain_url(const char *str)
+{
+        static const char *markers[] = { "://", "mailto:", "www.", "<a", "<img" };
+
+        for (const char *p = str; *p; p++) {
+                switch (*p) {
+                case ':': case 'm': case 'M': case 'w': case 'W': case '<':
+                        for (int i = 0; i < G_N_ELEMENTS(markers); i++)
+                                if (g_ascii_strncasecmp(p, markers[i], strlen(markers[i])) == 0)
+                                        return true;
                         break;
                 }
         }
 
-        n->msg = g_strchomp(n->msg);
+        return false;
+}
 
-        /* truncate overlong messages */
-        if (strlen(n->msg) > DUNST_NOTIF_MAX_CHARS) {
-                char *buffer = g_malloc(DUNST_NOTIF_MAX_CHARS);
-                strncpy(buffer, n->msg, DUNST_NOTIF_MAX_CHARS);
-                buffer[DUNST_NOTIF_MAX_CHARS-1] = '\0';
+/*
+ * Check if the notification has urls to indicate. Before the urls got
+ * extracted, the prefilter decides.
+ */
+static bool notification_has_urls(const notification *n)
+{
+        return n->urls_extracted ? n->urls != NULL : n->urls_maybe;
+}
 
-                g_free(n->msg);
-                n->msg = buffer;
+/* see notification.h */
+const char *notification_get_urls(notification *n)
+{
+        if (!n->urls_extracted) {
+                if (n->urls_maybe)
+                        notification_extract_urls(n);
+                n->urls_extracted = true;
         }
+
+        return n->urls;
+}
+
+/* see notification.h */
+const char *notification_get_actions_dmenu_str(notification *n)
+{
+        if (!n->actions)
+                return NULL;
+
+        if (!n->actions->dmenu_str)
+                notification_dmenu_string(n);
+
+        return n->actions->dmenu_str;
 }
 
 static void notification_extract_urls(notification *n)
@@ -473,9 +553,24 @@ static void notification_extract_urls(notification *n)
         // plain urls extraction
         char *urls_text = extract_urls(urls_in);
 
-        n->urls = string_append(n->urls, urls_a, "\n");
-        n->urls = string_append(n->urls, urls_img, "\n");
-        n->urls = string_append(n->urls, urls_text, "\n");
+        /* join the lists like string_append() with '\n' would */
+        const char *lists[] = { urls_a, urls_img, urls_text };
+        GString *urls = notification_scratch();
+        bool any = false;
+
+        for (int i = 0; i < G_N_ELEMENTS(lists); i++) {
+                if (urls->len == 0) {
+                        any = lists[i] != NULL;
+                        if (any)
+                                g_string_append(urls, lists[i]);
+                } else if (lists[i] && *lists[i]) {
+                        g_string_append_c(urls, '\n');
+                        g_string_append(urls, lists[i]);
+                }
+        }
+
+        if (any)
+                n->urls = g_strndup(urls->str, urls->len);
 
         g_free(urls_in);
         g_free(urls_a);
@@ -501,59 +596,91 @@ static void notification_dmenu_string(notification *n)
         }
 }
 
-void notification_update_text_to_render(notification *n)
+/*
+ * Build the part of text_to_render, which doesn't change over time.
+ */
+static char *notification_render_prefix(const notification *n)
 {
-        g_clear_pointer(&n->text_to_render, g_free);
-
-        char *buf = NULL;
+        const char *msg = n->msg;
 
-        char *msg = g_strchomp(n->msg);
+        bool urls = notification_has_urls(n);
 
         /* print dup_count and msg */
         if ((n->dup_count > 0 && !settings.hide_duplicate_count)
-            && (n->actions || n->urls) && settings.show_indicators) {
-                buf = g_strdup_printf("(%d%s%s) %s",
-                                      n->dup_count,
-                                      n->actions ? "A" : "",
-                                      n->urls ? "U" : "", msg);
-        } else if ((n->actions || n->urls) && settings.show_indicators) {
-                buf = g_strdup_printf("(%s%s) %s",
-                                      n->actions ? "A" : "",
-                                      n->urls ? "U" : "", msg);
+            && (n->actions || urls) && settings.show_indicators) {
+                return g_strdup_printf("(%d%s%s) %s",
+                                       n->dup_count,
+                                       n->actions ? "A" : "",
+                                       urls ? "U" : "", msg);
+        } else if ((n->actions || urls) && settings.show_indicators) {
+                return g_strdup_printf("(%s%s) %s",
+                                       n->actions ? "A" : "",
+                                       urls ? "U" : "", msg);
         } else if (n->dup_count > 0 && !settings.hide_duplicate_count) {
-                buf = g_strdup_printf("(%d) %s", n->dup_count, msg);
+                return g_strdup_printf("(%d) %s", n->dup_count, msg);
         } else {
-                buf = g_strdup(msg);
+                return g_strdup(msg);
+        }
+}
+
+/*
+ * Update text_to_render. The prefix only gets rebuilt if one of its parts
+ * changed and the age suffix only when the shown second changes.
+ */
+void notification_update_text_to_render(notification *n)
+{
+        struct render_cache *ttr = &n->ttr;
+
+        if (!ttr->prefix
+            || ttr->msg != n->msg
+            || ttr->dup_count != n->dup_count
+            || ttr->actions != (n->actions != NULL)
+            || ttr->urls != notification_has_urls(n)) {
+                g_free(ttr->prefix);
+                ttr->prefix = notification_render_prefix(n);
+                ttr->msg = n->msg;
+                ttr->dup_count = n->dup_count;
+                ttr->actions = n->actions != NULL;
+                ttr->urls = notification_has_urls(n);
+
+                g_clear_pointer(&n->text_to_render, g_free);
         }
 
         /* print age */
         gint64 hours, minutes, seconds;
         gint64 t_delta = g_get_monotonic_time() - n->timestamp;
+        gint64 age = -1;
 
         if (settings.show_age_threshold >= 0
-            && t_delta >= settings.show_age_threshold) {
-                hours   = t_delta / G_USEC_PER_SEC / 3600;
-                minutes = t_delta / G_USEC_PER_SEC / 60 % 60;
-                seconds = t_delta / G_USEC_PER_SEC % 60;
-
-                char *new_buf;
-                if (hours > 0) {
-                        new_buf =
-                            g_strdup_printf("%s (%ldh %ldm %lds old)", buf, hours,
-                                            minutes, seconds);
-                } else if (minutes > 0) {
-                        new_buf =
-                            g_strdup_printf("%s (%ldm %lds old)", buf, minutes,
-                                            seconds);
-                } else {
-                        new_buf = g_strdup_printf("%s (%lds old)", buf, seconds);
-                }
+            && t_delta >= settings.show_age_threshold)
+                age = t_delta / G_USEC_PER_SEC;
 
-                g_free(buf);
-                buf = new_buf;
+        if (n->text_to_render && ttr->age == age)
+                return;
+
+        g_free(n->text_to_render);
+        ttr->age = age;
+
+        if (age < 0) {
+                n->text_to_render = g_strdup(ttr->prefix);
+                return;
         }
 
-        n->text_to_render = buf;
+        hours   = age / 3600;
+        minutes = age / 60 % 60;
+        seconds = age % 60;
+
+        if (hours > 0) {
+                n->text_to_render =
+                    g_strdup_printf("%s (%ldh %ldm %lds old)", ttr->prefix, hours,
+                                    minutes, seconds);
+        } else if (minutes > 0) {
+                n->text_to_render =
+                    g_strdup_printf("%s (%ldm %lds old)", ttr->prefix, minutes,
+                                    seconds);
+        } else {
+                n->text_to_render = g_strdup_printf("%s (%lds old)", ttr->prefix, seconds);
+        }
 }
 
 /*
@@ -576,7 +703,7 @@ void notification_do_action(notification *n)
                 }
                 context_menu();
 
-        } else if (n->urls) {
+        } else if (notification_get_urls(n)) {
                 if (strstr(n->urls, "\n") == NULL)
                         open_browser(n->urls);
                 else
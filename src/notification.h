@@ -33,7 +33,9 @@ typedef struct _raw_image {
         int has_alpha;
         int bits_per_sample;
         int n_channels;
-        unsigned char *data;
+        const unsigned char *data; /**< the pixels, pointing into #bytes */
+        GBytes *bytes;             /**< the reference keeping #data alive */
+        bool argb32;               /**< #data is premultiplied ARGB32 as used by cairo */
 } RawImage;
 
 typedef struct _actions {
@@ -42,6 +44,20 @@ typedef struct _actions {
         gsize count;
 } Actions;
 
+/**
+ * Cached parts of #notification.text_to_render
+ *
+ * @see notification_update_text_to_render()
+ */
+struct render_cache {
+        char *prefix;    /**< indicators, dup_count and msg */
+        const char *msg; /**< the msg rendered into #prefix */
+        int dup_count;   /**< the dup_count rendered into #prefix */
+        bool actions;    /**< #prefix indicates actions */
+        bool urls;       /**< #prefix indicates urls */
+        gint64 age;      /**< the age in seconds appended to the prefix, -1 if none */
+};
+
 typedef struct _notification {
         int id;
         char *dbus_client;
@@ -75,13 +91,22 @@ typedef struct _notification {
         bool redisplayed;       /**< has been displayed before? */
         bool first_render;      /**< markup has been rendered before? */
         int dup_count;          /**< amount of duplicate notifications stacked onto this */
+        guint fingerprint;      /**< hash of the fields compared to detect duplicates */
         int displayed_height;
         enum behavior_fullscreen fullscreen; //!< The instruction what to do with it, when desktop enters fullscreen
 
         /* derived fields */
         char *msg;            /**< formatted message */
         char *text_to_render; /**< formatted message (with age and action indicators) */
-        char *urls;           /**< urllist delimited by '\\n' */
+        struct render_cache ttr; /**< cache to update #text_to_render */
+        char *urls;           /**< urllist delimited by '\\n', use notification_get_urls() */
+        bool urls_extracted;  /**< #urls got filled */
+        bool urls_maybe;      /**< summary or body may contain urls, until #urls got filled */
+
+        char *arena;          /**< (nullable) single block holding the owned strings after notification_init() */
+        gsize arena_size;     /**< size of #arena */
+
+        struct _colored_layout *layout; /**< (nullable) retained layout of the last redraw, see notification_release_layout() */
 } notification;
 
 notification *notification_create(void);
@@ -89,9 +114,17 @@ void notification_init(notification *n);
 void actions_free(Actions *a);
 void rawimage_free(RawImage *i);
 void notification_free(notification *n);
+
+/**
+ * Free the layout retained for drawing the notification
+ *
+ * It gets rebuilt when the notification gets displayed again.
+ */
+void notification_release_layout(notification *n);
 int notification_cmp(const void *a, const void *b);
 int notification_cmp_data(const void *a, const void *b, void *data);
 int notification_is_duplicate(const notification *a, const notification *b);
+guint notification_fingerprint(const notification *n);
 void notification_run_script(notification *n);
 void notification_print(notification *n);
 void notification_replace_single_field(char **haystack,
@@ -101,6 +134,21 @@ void notification_replace_single_field(char **haystack,
 void notification_update_text_to_render(notification *n);
 void notification_do_action(notification *n);
 
+/**
+ * Get the urls of the notification. They get extracted on the first call.
+ *
+ * @return (nullable) urllist delimited by '\\n'
+ */
+const char *notification_get_urls(notification *n);
+
+/**
+ * Get the dmenu representation of the notification's actions. It gets
+ * generated on the first call.
+ *
+ * @return (nullable) actionlist delimited by '\\n'
+ */
+const char *notification_get_actions_dmenu_str(notification *n);
+
 const char *notification_urgency_to_string(enum urgency urgency);
 
 /**
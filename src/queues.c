@@ -20,27 +20,346 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "heap.h"
 #include "log.h"
 #include "notification.h"
+#include "ring.h"
 #include "settings.h"
 
 /* notification lists */
-static GQueue *waiting   = NULL; /**< all new notifications get into here */
+static heap   *waiting   = NULL; /**< all new notifications get into here, holds struct queue_slot */
 static GQueue *displayed = NULL; /**< currently displayed notifications */
-static GQueue *history   = NULL; /**< history of displayed notifications */
+static ring   *history   = NULL; /**< history of displayed notifications, oldest first */
+
+/**
+ * Position of a notification inside the #waiting heap or #displayed queue
+ */
+struct queue_slot {
+        notification *n; /**< the notification */
+        GList *link;     /**< the node of #n inside #displayed, NULL if waiting */
+        guint pos;       /**< position of this slot inside #waiting */
+        guint64 seq;     /**< order of insertion into #waiting */
+        bool front;      /**< pulled from history, goes before all other waiting notifications */
+        heap *timers;    /**< (nullable) the expiry heap holding this slot */
+        guint timer;     /**< position of this slot inside #timers */
+};
+
+static guint64 waiting_seq = 0; /**< the last #queue_slot.seq handed out */
+
+/** Index of all waiting and displayed notifications: id -> struct queue_slot */
+static GHashTable *ids = NULL;
+
+/** Ids of the notifications in #history: id -> number of notifications */
+static GHashTable *history_ids = NULL;
+
+/** Candidates for stacking duplicates: fingerprint -> GSList of struct queue_slot */
+static GHashTable *fingerprints = NULL;
+
+/* expiry of displayed notifications, ordered by start + timeout */
+static heap *timers           = NULL; /**< notifications, which don't time out while the user is idle */
+static heap *timers_transient = NULL; /**< notifications, which time out albeit the user is idle */
+static bool timers_paused = false;    /**< #timers is frozen, as the user is idle */
 
 unsigned int displayed_limit = 0;
 int next_notification_id = 1;
 bool pause_displayed = false;
 
 static bool queues_stack_duplicate(notification *n);
+static gint queues_waiting_cmp(gconstpointer a, gconstpointer b);
+static void queues_waiting_set_index(gpointer item, guint index);
+static gint queues_timer_cmp(gconstpointer a, gconstpointer b);
+static void queues_timer_set_index(gpointer item, guint index);
 
 /* see queues.h */
 void queues_init(void)
 {
-        history   = g_queue_new();
+        history   = ring_new(0);
         displayed = g_queue_new();
-        waiting   = g_queue_new();
+        waiting   = heap_new(queues_waiting_cmp, queues_waiting_set_index);
+
+        ids = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+        history_ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+        fingerprints = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, (GDestroyNotify) g_slist_free);
+
+        timers           = heap_new(queues_timer_cmp, queues_timer_set_index);
+        timers_transient = heap_new(queues_timer_cmp, queues_timer_set_index);
+}
+
+/**
+ * Order the slots of the waiting heap like the sorted queue did before:
+ * notifications pulled from history first, then either by
+ * notification_cmp() or, if sorting is disabled, the latest insertion first.
+ */
+static gint queues_waiting_cmp(gconstpointer a, gconstpointer b)
+{
+        const struct queue_slot *sa = a;
+        const struct queue_slot *sb = b;
+
+        if (sa->front != sb->front)
+                return sb->front - sa->front;
+
+        if (sa->front || !settings.sort)
+                return (sa->seq < sb->seq) - (sa->seq > sb->seq);
+
+        return notification_cmp(sa->n, sb->n);
+}
+
+/**
+ * Track the position of a slot inside the waiting heap
+ */
+static void queues_waiting_set_index(gpointer item, guint index)
+{
+        ((struct queue_slot *) item)->pos = index;
+}
+
+/**
+ * Order the slots of the expiry heaps by the time their notification expires
+ */
+static gint queues_timer_cmp(gconstpointer a, gconstpointer b)
+{
+        const notification *na = ((const struct queue_slot *) a)->n;
+        const notification *nb = ((const struct queue_slot *) b)->n;
+
+        gint64 expiry_a = na->start + na->timeout;
+        gint64 expiry_b = nb->start + nb->timeout;
+
+        return (expiry_a > expiry_b) - (expiry_a < expiry_b);
+}
+
+/**
+ * Track the position of a slot inside its expiry heap
+ */
+static void queues_timer_set_index(gpointer item, guint index)
+{
+        ((struct queue_slot *) item)->timer = index;
+}
+
+/**
+ * Remove the slot from its expiry heap, if it is scheduled
+ */
+static void queues_timer_unschedule(struct queue_slot *slot)
+{
+        if (!slot->timers)
+                return;
+
+        heap_remove(slot->timers, slot->timer);
+        slot->timers = NULL;
+}
+
+/**
+ * Schedule the expiry of a notification after its queue, its start or
+ * its timeout changed. Only displayed notifications with a timeout expire.
+ *
+ * @param slot The slot of the notification
+ */
+static void queues_timer_schedule(struct queue_slot *slot)
+{
+        notification *n = slot->n;
+        heap *target = NULL;
+
+        if (slot->link && n->start != 0 && n->timeout != 0)
+                target = n->transient ? timers_transient : timers;
+
+        if (slot->timers == target) {
+                if (target)
+                        heap_update(target, slot->timer);
+                return;
+        }
+
+        queues_timer_unschedule(slot);
+
+        if (target) {
+                slot->timers = target;
+                heap_push(target, slot);
+        }
+}
+
+/**
+ * Look up the position of the notification with the given id
+ *
+ * @param id The id of the notification
+ *
+ * @return the slot of the notification, if it is waiting or displayed
+ * @return NULL, if no such notification exists
+ */
+static struct queue_slot *queues_index_lookup(int id)
+{
+        return g_hash_table_lookup(ids, GINT_TO_POINTER(id));
+}
+
+/**
+ * Count a notification entering or leaving #history in #history_ids
+ *
+ * @param id The id of the notification
+ * @param delta 1, if it entered history, -1 if it left
+ */
+static void queues_history_count(int id, int delta)
+{
+        gpointer key = GINT_TO_POINTER(id);
+        int count = GPOINTER_TO_INT(g_hash_table_lookup(history_ids, key)) + delta;
+
+        if (count > 0)
+                g_hash_table_insert(history_ids, key, GINT_TO_POINTER(count));
+        else
+                g_hash_table_remove(history_ids, key);
+}
+
+/**
+ * Add the notification of the slot to the duplicate candidates
+ */
+static void queues_fingerprint_add(struct queue_slot *slot)
+{
+        notification *n = slot->n;
+        gpointer key = GUINT_TO_POINTER(n->fingerprint);
+        GSList *bucket = g_hash_table_lookup(fingerprints, key);
+
+        g_hash_table_steal(fingerprints, key);
+        g_hash_table_insert(fingerprints, key, g_slist_prepend(bucket, slot));
+}
+
+/**
+ * Remove the notification of the slot from the duplicate candidates
+ */
+static void queues_fingerprint_remove(struct queue_slot *slot)
+{
+        notification *n = slot->n;
+        gpointer key = GUINT_TO_POINTER(n->fingerprint);
+        GSList *bucket = g_hash_table_lookup(fingerprints, key);
+
+        g_hash_table_steal(fingerprints, key);
+        bucket = g_slist_remove(bucket, slot);
+        if (bucket)
+                g_hash_table_insert(fingerprints, key, bucket);
+}
+
+/**
+ * Create the slot of a notification, which enters the queues, and
+ * register it in the id index
+ *
+ * If the id is taken already, the notification gets a new one.
+ *
+ * @param n The notification
+ *
+ * @return the slot, which is neither waiting nor displayed yet
+ */
+static struct queue_slot *queues_slot_new(notification *n)
+{
+        struct queue_slot *slot = g_malloc0(sizeof(struct queue_slot));
+
+        /* e.g. a notification pulled from history, whose id got
+         * requested by a client in the meantime */
+        if (queues_index_lookup(n->id))
+                n->id = queues_reserve_id();
+
+        slot->n = n;
+        g_hash_table_insert(ids, GINT_TO_POINTER(n->id), slot);
+        queues_fingerprint_add(slot);
+
+        return slot;
+}
+
+/**
+ * Remove the slot from the id index and free it
+ *
+ * @param slot The slot, which got detached from its queue
+ */
+static void queues_slot_free(struct queue_slot *slot)
+{
+        queues_timer_unschedule(slot);
+        queues_fingerprint_remove(slot);
+        g_hash_table_remove(ids, GINT_TO_POINTER(slot->n->id));
+}
+
+/**
+ * Remove the slot from the waiting heap or the displayed queue
+ */
+static void queues_slot_detach(struct queue_slot *slot)
+{
+        if (slot->link) {
+                g_queue_delete_link(displayed, slot->link);
+                slot->link = NULL;
+        } else {
+                heap_remove(waiting, slot->pos);
+        }
+
+        queues_timer_unschedule(slot);
+}
+
+/**
+ * Put another notification into the place of the slot's notification
+ *
+ * @param slot The slot to reuse
+ * @param n The notification, which replaces the current one
+ */
+static void queues_slot_replace(struct queue_slot *slot, notification *n)
+{
+        queues_fingerprint_remove(slot);
+
+        if (slot->n->id != n->id) {
+                g_hash_table_steal(ids, GINT_TO_POINTER(slot->n->id));
+                g_hash_table_insert(ids, GINT_TO_POINTER(n->id), slot);
+        }
+
+        slot->n = n;
+        if (slot->link)
+                slot->link->data = n;
+        else
+                heap_update(waiting, slot->pos);
+
+        queues_fingerprint_add(slot);
+        queues_timer_schedule(slot);
+}
+
+/**
+ * Prepare a detached slot to enter the waiting heap
+ *
+ * @param slot The slot
+ * @param front Put the slot before all other waiting notifications
+ */
+static void queues_waiting_prepare(struct queue_slot *slot, bool front)
+{
+        slot->link = NULL;
+        slot->seq = ++waiting_seq;
+        slot->front = front;
+}
+
+/**
+ * Insert a detached slot into the waiting heap
+ *
+ * @param slot The slot
+ * @param front Put the slot before all other waiting notifications
+ */
+static void queues_waiting_push(struct queue_slot *slot, bool front)
+{
+        queues_waiting_prepare(slot, front);
+        heap_push(waiting, slot);
+}
+
+/**
+ * Insert a detached slot into the displayed queue, respecting the sort
+ * order of notification_cmp()
+ *
+ * Behaves like `g_queue_insert_sorted()` with notification_cmp_data().
+ *
+ * @param slot The slot
+ */
+static void queues_displayed_insert(struct queue_slot *slot)
+{
+        GList *sibling = g_queue_peek_head_link(displayed);
+
+        while (sibling && notification_cmp(sibling->data, slot->n) < 0)
+                sibling = sibling->next;
+
+        if (sibling) {
+                g_queue_insert_before(displayed, sibling, slot->n);
+                slot->link = sibling->prev;
+        } else {
+                g_queue_push_tail(displayed, slot->n);
+                slot->link = g_queue_peek_tail_link(displayed);
+        }
+
+        queues_timer_schedule(slot);
 }
 
 /* see queues.h */
@@ -58,7 +377,7 @@ const GList *queues_get_displayed(void)
 /* see queues.h */
 unsigned int queues_length_waiting(void)
 {
-        return waiting->length;
+        return heap_length(waiting);
 }
 
 /* see queues.h */
@@ -70,11 +389,34 @@ unsigned int queues_length_displayed(void)
 /* see queues.h */
 unsigned int queues_length_history(void)
 {
-        return history->length;
+        return ring_length(history);
+}
+
+/* see queues.h */
+const notification *queues_get_history(unsigned int index)
+{
+        unsigned int length = ring_length(history);
+
+        if (index >= length)
+                return NULL;
+
+        return ring_get(history, length - 1 - index);
+}
+
+/* see queues.h */
+guint queues_reserve_id(void)
+{
+        /* clients may request any id, skip the ones in use */
+        do {
+                next_notification_id++;
+        } while (queues_index_lookup(next_notification_id)
+                 || g_hash_table_contains(history_ids, GINT_TO_POINTER(next_notification_id)));
+
+        return next_notification_id;
 }
 
 /* see queues.h */
-int queues_notification_insert(notification *n)
+int queues_notification_insert(notification *n, bool replaces)
 {
 
         /* do not display the message, if the message is empty */
@@ -95,13 +437,14 @@ int queues_notification_insert(notification *n)
                 return 0;
         }
 
-        if (n->id == 0) {
-                n->id = ++next_notification_id;
+        if (!replaces || n->id == 0) {
+                if (n->id == 0)
+                        n->id = queues_reserve_id();
                 if (!settings.stack_duplicates || !queues_stack_duplicate(n))
-                        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+                        queues_waiting_push(queues_slot_new(n), false);
         } else {
                 if (!queues_notification_replace_id(n))
-                        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+                        queues_waiting_push(queues_slot_new(n), false);
         }
 
         if (settings.print_notifications)
@@ -113,127 +456,91 @@ int queues_notification_insert(notification *n)
 /**
  * Replaces duplicate notification and stacks it
  *
+ * Candidates are looked up by the fingerprint of the notification,
+ * preferring a displayed duplicate over a waiting one.
+ *
  * @return true, if notification got stacked
  * @return false, if notification did not get stacked
  */
 static bool queues_stack_duplicate(notification *n)
 {
-        for (GList *iter = g_queue_peek_head_link(displayed); iter;
-             iter = iter->next) {
-                notification *orig = iter->data;
-                if (notification_is_duplicate(orig, n)) {
-                        /* If the progress differs, probably notify-send was used to update the notification
-                         * So only count it as a duplicate, if the progress was not the same.
-                         * */
-                        if (orig->progress == n->progress) {
-                                orig->dup_count++;
-                        } else {
-                                orig->progress = n->progress;
-                        }
+        struct queue_slot *dup = NULL;
 
-                        iter->data = n;
+        for (GSList *iter = g_hash_table_lookup(fingerprints, GUINT_TO_POINTER(n->fingerprint));
+             iter; iter = iter->next) {
+                struct queue_slot *slot = iter->data;
+                if (!notification_is_duplicate(slot->n, n))
+                        continue;
 
-                        n->start = g_get_monotonic_time();
+                dup = slot;
+                if (slot->link)
+                        break;
+        }
 
-                        n->dup_count = orig->dup_count;
+        if (!dup)
+                return false;
 
-                        signal_notification_closed(orig, 1);
+        notification *orig = dup->n;
 
-                        notification_free(orig);
-                        return true;
-                }
+        /* If the progress differs, probably notify-send was used to update the notification
+         * So only count it as a duplicate, if the progress was not the same.
+         * */
+        if (orig->progress == n->progress) {
+                orig->dup_count++;
+        } else {
+                orig->progress = n->progress;
         }
 
-        for (GList *iter = g_queue_peek_head_link(waiting); iter;
-             iter = iter->next) {
-                notification *orig = iter->data;
-                if (notification_is_duplicate(orig, n)) {
-                        /* If the progress differs, probably notify-send was used to update the notification
-                         * So only count it as a duplicate, if the progress was not the same.
-                         * */
-                        if (orig->progress == n->progress) {
-                                orig->dup_count++;
-                        } else {
-                                orig->progress = n->progress;
-                        }
-                        iter->data = n;
-
-                        n->dup_count = orig->dup_count;
+        if (dup->link)
+                n->start = g_get_monotonic_time();
 
-                        signal_notification_closed(orig, 1);
+        n->dup_count = orig->dup_count;
+        queues_slot_replace(dup, n);
 
-                        notification_free(orig);
-                        return true;
-                }
-        }
+        signal_notification_closed(orig, 1);
 
-        return false;
+        notification_free(orig);
+        return true;
 }
 
 /* see queues.h */
 bool queues_notification_replace_id(notification *new)
 {
+        struct queue_slot *slot = queues_index_lookup(new->id);
 
-        for (GList *iter = g_queue_peek_head_link(displayed);
-                    iter;
-                    iter = iter->next) {
-                notification *old = iter->data;
-                if (old->id == new->id) {
-                        iter->data = new;
-                        new->start = g_get_monotonic_time();
-                        new->dup_count = old->dup_count;
-                        notification_run_script(new);
-                        notification_free(old);
-                        return true;
-                }
-        }
+        if (!slot)
+                return false;
 
-        for (GList *iter = g_queue_peek_head_link(waiting);
-                    iter;
-                    iter = iter->next) {
-                notification *old = iter->data;
-                if (old->id == new->id) {
-                        iter->data = new;
-                        new->dup_count = old->dup_count;
-                        notification_free(old);
-                        return true;
-                }
+        notification *old = slot->n;
+        new->dup_count = old->dup_count;
+
+        if (slot->link) {
+                new->start = g_get_monotonic_time();
+                notification_run_script(new);
         }
-        return false;
+
+        queues_slot_replace(slot, new);
+
+        notification_free(old);
+        return true;
 }
 
 /* see queues.h */
 void queues_notification_close_id(int id, enum reason reason)
 {
-        notification *target = NULL;
+        struct queue_slot *slot = queues_index_lookup(id);
 
-        for (GList *iter = g_queue_peek_head_link(displayed); iter;
-             iter = iter->next) {
-                notification *n = iter->data;
-                if (n->id == id) {
-                        g_queue_remove(displayed, n);
-                        target = n;
-                        break;
-                }
-        }
+        if (!slot)
+                return;
 
-        for (GList *iter = g_queue_peek_head_link(waiting); iter;
-             iter = iter->next) {
-                notification *n = iter->data;
-                if (n->id == id) {
-                        assert(target == NULL);
-                        g_queue_remove(waiting, n);
-                        target = n;
-                        break;
-                }
-        }
+        notification *target = slot->n;
+        queues_slot_detach(slot);
+        queues_slot_free(slot);
 
-        if (target) {
-                //Don't notify clients if notification was pulled from history
-                if (!target->redisplayed)
-                        signal_notification_closed(target, reason);
-                queues_history_push(target);
-        }
+        //Don't notify clients if notification was pulled from history
+        if (!target->redisplayed)
+                signal_notification_closed(target, reason);
+        queues_history_push(target);
 }
 
 /* see queues.h */
@@ -246,26 +553,34 @@ void queues_notification_close(notification *n, enum reason reason)
 /* see queues.h */
 void queues_history_pop(void)
 {
-        if (g_queue_is_empty(history))
+        notification *n = ring_pop(history);
+        if (!n)
                 return;
 
-        notification *n = g_queue_pop_tail(history);
+        queues_history_count(n->id, -1);
         n->redisplayed = true;
         n->start = 0;
         n->timeout = settings.sticky_history ? 0 : n->timeout;
-        g_queue_push_head(waiting, n);
+        queues_waiting_push(queues_slot_new(n), true);
 }
 
 /* see queues.h */
 void queues_history_push(notification *n)
 {
         if (!n->history_ignore) {
-                if (settings.history_length > 0 && history->length >= settings.history_length) {
-                        notification *to_free = g_queue_pop_head(history);
-                        notification_free(to_free);
+                if (settings.history_length > 0) {
+                        ring_reserve(history, settings.history_length);
+
+                        if (ring_length(history) >= settings.history_length) {
+                                notification *to_free = ring_shift(history);
+                                queues_history_count(to_free->id, -1);
+                                notification_free(to_free);
+                        }
                 }
 
-                g_queue_push_tail(history, n);
+                notification_release_layout(n);
+                ring_push(history, n);
+                queues_history_count(n->id, 1);
         } else {
                 notification_free(n);
         }
@@ -278,93 +593,116 @@ void queues_history_push_all(void)
                 queues_notification_close(g_queue_peek_head_link(displayed)->data, REASON_USER);
         }
 
-        while (waiting->length > 0) {
-                queues_notification_close(g_queue_peek_head_link(waiting)->data, REASON_USER);
+        while (heap_length(waiting) > 0) {
+                struct queue_slot *slot = heap_peek(waiting);
+                queues_notification_close(slot->n, REASON_USER);
         }
 }
 
-/* see queues.h */
-void queues_check_timeouts(bool idle, bool fullscreen)
+/**
+ * Close all notifications of the expiry heap, which hit their timeout
+ *
+ * @param h The expiry heap
+ * @param now The current time
+ */
+static void queues_timers_expire(heap *h, gint64 now)
 {
-        /* nothing to do */
-        if (displayed->length == 0)
-                return;
-
-        bool is_idle = fullscreen ? false : idle;
+        struct queue_slot *slot;
 
-        GList *iter = g_queue_peek_head_link(displayed);
-        while (iter) {
-                notification *n = iter->data;
+        while ((slot = heap_peek(h))) {
+                notification *n = slot->n;
 
-                /*
-                 * Update iter to the next item before we either exit the
-                 * current iteration of the loop or potentially delete the
-                 * notification which would invalidate the pointer.
-                 */
-                iter = iter->next;
+                if (now - n->start <= n->timeout)
+                        break;
 
-                /* don't timeout when user is idle */
-                if (is_idle && !n->transient) {
-                        n->start = g_get_monotonic_time();
-                        continue;
-                }
+                queues_notification_close(n, REASON_TIME);
+        }
+}
 
-                /* skip hidden and sticky messages */
-                if (n->start == 0 || n->timeout == 0) {
-                        continue;
-                }
+/* see queues.h */
+void queues_check_timeouts(bool idle, bool fullscreen)
+{
+        gint64 now = g_get_monotonic_time();
+        bool is_idle = fullscreen ? false : idle;
 
-                /* remove old message */
-                if (g_get_monotonic_time() - n->start > n->timeout) {
-                        queues_notification_close(n, REASON_TIME);
+        /* don't timeout when user is idle, but restart the
+         * timeouts of all notifications when the user returns */
+        if (timers_paused && !is_idle) {
+                for (guint i = 0; i < heap_length(timers); i++) {
+                        struct queue_slot *slot = heap_get(timers, i);
+                        notification *n = slot->n;
+                        n->start = now;
                 }
+                heap_rebuild(timers);
         }
+        timers_paused = is_idle;
+
+        queues_timers_expire(timers_transient, now);
+        if (!timers_paused)
+                queues_timers_expire(timers, now);
+}
+
+/**
+ * Move detached slots into the waiting heap at once, in the order of the
+ * array as if they got inserted one by one
+ *
+ * @param slots The slots, the array gets freed
+ */
+static void queues_waiting_merge(GPtrArray *slots)
+{
+        for (guint i = 0; i < slots->len; i++)
+                queues_waiting_prepare(slots->pdata[i], false);
+
+        heap_merge(waiting, slots);
+        g_ptr_array_free(slots, TRUE);
 }
 
 /* see queues.h */
 void queues_update(bool fullscreen)
 {
         if (pause_displayed) {
+                GPtrArray *paused = g_ptr_array_sized_new(displayed->length);
                 while (displayed->length > 0) {
-                        g_queue_insert_sorted(
-                            waiting, g_queue_pop_head(displayed), notification_cmp_data, NULL);
+                        notification *n = g_queue_peek_head(displayed);
+                        struct queue_slot *slot = queues_index_lookup(n->id);
+                        queues_slot_detach(slot);
+                        g_ptr_array_add(paused, slot);
                 }
+                queues_waiting_merge(paused);
                 return;
         }
 
         /* move notifications back to queue, which are set to pushback */
         if (fullscreen) {
+                GPtrArray *pushback = g_ptr_array_new();
                 GList *iter = g_queue_peek_head_link(displayed);
                 while (iter) {
                         notification *n = iter->data;
                         GList *nextiter = iter->next;
 
                         if (n->fullscreen == FS_PUSHBACK){
-                                g_queue_delete_link(displayed, iter);
-                                g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+                                struct queue_slot *slot = queues_index_lookup(n->id);
+                                queues_slot_detach(slot);
+                                g_ptr_array_add(pushback, slot);
                         }
 
                         iter = nextiter;
                 }
+                queues_waiting_merge(pushback);
         }
 
         /* move notifications from queue to displayed */
-        GList *iter = g_queue_peek_head_link(waiting);
-        while (iter) {
-                notification *n = iter->data;
-                GList *nextiter = iter->next;
-
-                if (displayed_limit > 0 && displayed->length >= displayed_limit) {
-                        /* the list is full */
+        GPtrArray *delayed = g_ptr_array_new();
+        while (displayed_limit == 0 || displayed->length < displayed_limit) {
+                struct queue_slot *slot = heap_pop(waiting);
+                if (!slot)
                         break;
-                }
 
-                if (!n)
-                        return;
+                notification *n = slot->n;
 
                 if (fullscreen
                     && (n->fullscreen == FS_DELAY || n->fullscreen == FS_PUSHBACK)) {
-                        iter = nextiter;
+                        g_ptr_array_add(delayed, slot);
                         continue;
                 }
 
@@ -374,11 +712,12 @@ void queues_update(bool fullscreen)
                         notification_run_script(n);
                 }
 
-                g_queue_delete_link(waiting, iter);
-                g_queue_insert_sorted(displayed, n, notification_cmp_data, NULL);
-
-                iter = nextiter;
+                queues_displayed_insert(slot);
         }
+
+        /* the delayed notifications keep their place in the waiting order */
+        heap_merge(waiting, delayed);
+        g_ptr_array_free(delayed, TRUE);
 }
 
 /* see queues.h */
@@ -386,20 +725,37 @@ gint64 queues_get_next_datachange(gint64 time)
 {
         gint64 sleep = G_MAXINT64;
 
-        for (GList *iter = g_queue_peek_head_link(displayed); iter;
-                        iter = iter->next) {
-                notification *n = iter->data;
+        heap *active[] = { timers_transient, timers_paused ? NULL : timers };
+        for (int i = 0; i < G_N_ELEMENTS(active); i++) {
+                struct queue_slot *slot = active[i] ? heap_peek(active[i]) : NULL;
+                if (!slot)
+                        continue;
+
+                notification *n = slot->n;
                 gint64 ttl = n->timeout - (time - n->start);
 
-                if (n->timeout > 0) {
-                        if (ttl > 0)
-                                sleep = MIN(sleep, ttl);
-                        else
-                                // while we're processing, the notification already timed out
-                                return 0;
-                }
+                if (ttl > 0)
+                        sleep = MIN(sleep, ttl);
+                else
+                        // while we're processing, the notification already timed out
+                        return 0;
+        }
 
-                if (settings.show_age_threshold >= 0) {
+        /* Idleness gets polled, so keep checking for the user to return,
+         * who restarts the frozen timeouts */
+        struct queue_slot *frozen = timers_paused ? heap_peek(timers) : NULL;
+        if (frozen) {
+                gint64 poll = frozen->n->timeout;
+                if (settings.idle_threshold > 0)
+                        poll = MIN(poll, settings.idle_threshold);
+                sleep = MIN(sleep, poll);
+        }
+
+        if (settings.show_age_threshold >= 0) {
+                for (GList *iter = g_queue_peek_head_link(displayed); iter;
+                                iter = iter->next) {
+                        notification *n = iter->data;
+                        gint64 ttl = n->timeout - (time - n->start);
                         gint64 age = time - n->timestamp;
 
                         if (age > settings.show_age_threshold)
@@ -445,8 +801,19 @@ static void teardown_notification(gpointer data)
 /* see queues.h */
 void teardown_queues(void)
 {
-        g_queue_free_full(history, teardown_notification);
+        ring_free(history, teardown_notification);
         g_queue_free_full(displayed, teardown_notification);
-        g_queue_free_full(waiting, teardown_notification);
+        for (guint i = 0; i < heap_length(waiting); i++) {
+                struct queue_slot *slot = heap_get(waiting, i);
+                teardown_notification(slot->n);
+        }
+        heap_free(waiting);
+
+        g_hash_table_destroy(ids);
+        g_hash_table_destroy(history_ids);
+        g_hash_table_destroy(fingerprints);
+
+        heap_free(timers);
+        heap_free(timers_transient);
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -51,20 +51,42 @@ unsigned int queues_length_displayed(void);
  */
 unsigned int queues_length_history(void);
 
+/**
+ * Receive a notification from history without removing it
+ *
+ * @param index The position in history, 0 is the latest notification
+ *
+ * @return read only notification
+ * @return NULL, if `index` is not smaller than queues_length_history()
+ */
+const notification *queues_get_history(unsigned int index);
+
 /**
  * Insert a fully initialized notification into queues
  *
  * Respects stack_duplicates, and notification replacement
  *
  * @param n the notification to insert
+ * @param replaces whether n->id was requested by the sender to replace
+ *                 the notification with the same id
  *
- * - If n->id != 0, n replaces notification n with id n->id
  * - If n->id == 0, n gets a new id assigned
+ * - If `replaces` is set, n replaces the notification with id n->id
+ * - Otherwise n->id has to be reserved via queues_reserve_id()
  *
- * @return `0`, the notification was dismissed and freed
+ * @return `0`, the notification was dismissed
  * @return The new value of `n->id`
  */
-int queues_notification_insert(notification *n);
+int queues_notification_insert(notification *n, bool replaces);
+
+/**
+ * Reserve the id for a new notification
+ *
+ * Allows to tell the sender the id of its notification before it gets
+ * inserted via queues_notification_insert(). Skips the ids of all waiting,
+ * displayed and history notifications, as clients may request any id.
+ */
+guint queues_reserve_id(void);
 
 /**
  * Replace the notification which matches the id field of
@@ -0,0 +1,111 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#include "ring.h"
+
+#include <assert.h>
+#include <glib.h>
+#include <string.h>
+
+#define RING_MIN_CAPACITY 16
+
+/**
+ * Map a position counted from the oldest item to an offset into the storage
+ */
+static inline guint ring_offset(const ring *r, guint index)
+{
+        guint offset = r->head + index;
+        return offset < r->capacity ? offset : offset - r->capacity;
+}
+
+/* see ring.h */
+ring *ring_new(guint capacity)
+{
+        ring *r = g_malloc0(sizeof(ring));
+
+        ring_reserve(r, capacity);
+
+        return r;
+}
+
+/* see ring.h */
+void ring_free(ring *r, GDestroyNotify free_func)
+{
+        if (!r)
+                return;
+
+        if (free_func)
+                for (guint i = 0; i < r->length; i++)
+                        free_func(ring_get(r, i));
+
+        g_free(r->items);
+        g_free(r);
+}
+
+/* see ring.h */
+void ring_reserve(ring *r, guint capacity)
+{
+        if (capacity <= r->capacity)
+                return;
+
+        gpointer *items = g_malloc(capacity * sizeof(gpointer));
+
+        /* unwrap the items, so that the oldest item lands at 0 */
+        guint tail = MIN(r->length, r->capacity - r->head);
+        if (r->length > 0) {
+                memcpy(items, r->items + r->head, tail * sizeof(gpointer));
+                memcpy(items + tail, r->items, (r->length - tail) * sizeof(gpointer));
+        }
+
+        g_free(r->items);
+        r->items = items;
+        r->capacity = capacity;
+        r->head = 0;
+}
+
+/* see ring.h */
+guint ring_length(const ring *r)
+{
+        return r->length;
+}
+
+/* see ring.h */
+gpointer ring_get(const ring *r, guint index)
+{
+        assert(index < r->length);
+
+        return r->items[ring_offset(r, index)];
+}
+
+/* see ring.h */
+void ring_push(ring *r, gpointer item)
+{
+        if (r->length == r->capacity)
+                ring_reserve(r, MAX(RING_MIN_CAPACITY, r->capacity * 2));
+
+        r->items[ring_offset(r, r->length)] = item;
+        r->length++;
+}
+
+/* see ring.h */
+gpointer ring_pop(ring *r)
+{
+        if (r->length == 0)
+                return NULL;
+
+        r->length--;
+        return r->items[ring_offset(r, r->length)];
+}
+
+/* see ring.h */
+gpointer ring_shift(ring *r)
+{
+        if (r->length == 0)
+                return NULL;
+
+        gpointer item = r->items[r->head];
+        r->head = ring_offset(r, 1);
+        r->length--;
+
+        return item;
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,75 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+#ifndef DUNST_RING_H
+#define DUNST_RING_H
+
+#include <glib.h>
+
+/**
+ * A ring buffer of arbitrary pointers
+ *
+ * Items get pushed at the newest end and can be removed from both ends
+ * in `O(1)`. When the buffer is full, it grows geometrically.
+ */
+typedef struct _ring {
+        gpointer *items; /**< the storage, #capacity items wide */
+        guint capacity;  /**< the amount of allocated items */
+        guint head;      /**< the position of the oldest item in #items */
+        guint length;    /**< the amount of stored items */
+} ring;
+
+/**
+ * Create a new, empty ring buffer
+ *
+ * @param capacity The amount of items to preallocate, may be 0
+ */
+ring *ring_new(guint capacity);
+
+/**
+ * Free the ring buffer
+ *
+ * @param r (nullable) The ring buffer to free
+ * @param free_func (nullable) The function to free the remaining items
+ */
+void ring_free(ring *r, GDestroyNotify free_func);
+
+/**
+ * Grow the storage to hold at least `capacity` items without further
+ * allocations
+ */
+void ring_reserve(ring *r, guint capacity);
+
+/**
+ * @return the amount of items in the ring buffer
+ */
+guint ring_length(const ring *r);
+
+/**
+ * Get an item by its age
+ *
+ * @param r The ring buffer
+ * @param index The position counted from the oldest item (0) on, smaller
+ *              than ring_length()
+ */
+gpointer ring_get(const ring *r, guint index);
+
+/**
+ * Append an item as the newest item
+ */
+void ring_push(ring *r, gpointer item);
+
+/**
+ * Remove the newest item
+ *
+ * @return the newest item or NULL, if the ring buffer is empty
+ */
+gpointer ring_pop(ring *r);
+
+/**
+ * Remove the oldest item
+ *
+ * @return the oldest item or NULL, if the ring buffer is empty
+ */
+gpointer ring_shift(ring *r);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
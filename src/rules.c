@@ -4,8 +4,462 @@
 
 #include <fnmatch.h>
 #include <glib.h>
+#include <string.h>
+#include <time.h>
 
 #include "dunst.h"
+#include "globset.h"
+#include "intern.h"
+#include "log.h"
+#include "settings.h"
+
+enum matcher_kind {
+        MATCHER_ANY,
+        MATCHER_LITERAL,
+        MATCHER_PREFIX,
+        MATCHER_SUFFIX,
+        MATCHER_SUBSTRING,
+        MATCHER_FNMATCH,
+        MATCHER_GLOBSET,
+        MATCHER_REGEX,
+};
+
+/*
+ * A precompiled filter pattern.
+ *
+ * text and len describe the literal part of the pattern for all kinds
+ * but MATCHER_ANY, MATCHER_FNMATCH, MATCHER_GLOBSET and MATCHER_REGEX.
+ * Substring matchers own a copy of it, all others point into the pattern.
+ *
+ * Regex matchers borrow the compiled expression of the rule.
+ *
+ * MATCHER_GLOBSET patterns are part of the globset of their field and get
+ * looked up in the bitset of its result.
+ */
+struct matcher {
+        enum matcher_kind kind;
+        const char *pattern;
+        const char *text;
+        gsize len;
+        GRegex *regex;
+};
+
+struct compiled_rule {
+        rule_t *rule;
+        guint position;
+        bool content;           /* filters on the summary or body */
+        struct matcher appname;
+        struct matcher summary;
+        struct matcher body;
+        struct matcher icon;
+        struct matcher category;
+};
+
+
+/*
+ * The rule index built by rules_compile().
+ *
+ * Rules with a literal appname are only candidates for notifications of
+ * that application, rules with a literal category (and an appname glob)
+ * only for notifications of that category. All remaining rules have to
+ * be checked against every notification.
+ */
+static struct {
+        struct compiled_rule *rules;
+        guint n_rules;
+        GHashTable *by_appname;
+        GHashTable *by_category;
+        GPtrArray *generic;
+        globset *summaries;
+        globset *bodies;
+} rule_index;
+
+/*
+ * The attributes of a notification, which the rules without summary and
+ * body filters depend on. The strings are interned references.
+ */
+struct rule_memo_key {
+        char *appname;
+        char *category;
+        char *icon;
+        enum urgency urgency;
+        bool transient;
+};
+
+/*
+ * The rules without summary and body filters, which matched a
+ * notification with the given attributes, in rule order.
+ */
+struct rule_memo {
+        struct rule_memo_key key;
+        guint n_rules;
+        struct compiled_rule *rules[];
+};
+
+/* The amount of memos to keep before starting over */
+#define RULE_MEMO_MAX 256
+
+static GHashTable *rule_memos = NULL;
+static struct rule_memo_stats memo_stats = { 0, 0 };
+
+static struct rule_stats total_stats = { 0, 0, 0 };
+
+/*
+ * The globset results of the fields of a single notification.
+ *
+ * Each field is scanned at most once, when the first candidate rule
+ * needs it.
+ */
+struct rule_scan {
+        guint32 *summary;
+        guint32 *body;
+};
+
+/*
+ * Classify the glob pattern into the cheapest matcher that gives the
+ * same result as fnmatch(pattern, str, 0).
+ */
+static void matcher_compile(struct matcher *m, const char *pattern)
+{
+        m->pattern = pattern;
+        m->text = NULL;
+        m->len = 0;
+        m->regex = NULL;
+
+        if (!pattern) {
+                m->kind = MATCHER_ANY;
+                return;
+        }
+
+        /* brackets, escapes and single char wildcards are left to fnmatch */
+        if (strpbrk(pattern, "?[\\")) {
+                m->kind = MATCHER_FNMATCH;
+                return;
+        }
+
+        gsize len = strlen(pattern);
+        const char *first = strchr(pattern, '*');
+
+        if (!first) {
+                m->kind = MATCHER_LITERAL;
+                m->text = pattern;
+                m->len = len;
+                return;
+        }
+
+        gsize lead = strspn(pattern, "*");
+        if (lead == len) {
+                m->kind = MATCHER_ANY;
+                return;
+        }
+
+        gsize tail = 0;
+        while (pattern[len - tail - 1] == '*')
+                tail++;
+
+        /* any star left inside the literal part needs the real thing */
+        if (memchr(pattern + lead, '*', len - lead - tail)) {
+                m->kind = MATCHER_FNMATCH;
+                return;
+        }
+
+        m->text = pattern + lead;
+        m->len = len - lead - tail;
+
+        if (lead && tail) {
+                /* strstr needs the literal part on its own */
+                m->kind = MATCHER_SUBSTRING;
+                m->text = g_strndup(m->text, m->len);
+        } else if (lead)
+                m->kind = MATCHER_SUFFIX;
+        else
+                m->kind = MATCHER_PREFIX;
+}
+
+/*
+ * Use the compiled expression of a MATCH_REGEX rule for the pattern.
+ */
+static void matcher_compile_regex(struct matcher *m, const char *pattern, GRegex *regex)
+{
+        matcher_compile(m, NULL);
+
+        if (pattern) {
+                m->kind = MATCHER_REGEX;
+                m->pattern = pattern;
+                m->regex = regex;
+        }
+}
+
+static void matcher_free(struct matcher *m)
+{
+        if (m->kind == MATCHER_SUBSTRING)
+                g_free((char *) m->text);
+}
+
+static bool matcher_matches(const struct matcher *m, const char *str)
+{
+        if (m->kind == MATCHER_ANY)
+                return true;
+
+        if (!str)
+                str = "";
+
+        switch (m->kind) {
+        case MATCHER_LITERAL:
+                return str == m->text || strcmp(str, m->text) == 0;
+        case MATCHER_PREFIX:
+                return strncmp(str, m->text, m->len) == 0;
+        case MATCHER_SUFFIX: {
+                gsize len = strlen(str);
+                return len >= m->len
+                    && memcmp(str + len - m->len, m->text, m->len) == 0;
+        }
+        case MATCHER_SUBSTRING:
+                return strstr(str, m->text) != NULL;
+        case MATCHER_FNMATCH:
+                return fnmatch(m->pattern, str, 0) == 0;
+        case MATCHER_REGEX:
+                return m->regex && g_regex_match(m->regex, str, 0, NULL);
+        default:
+                return true;
+        }
+}
+
+/*
+ * Add the pattern to the globset of its field if the globset can handle it.
+ */
+static void matcher_compile_globset(struct matcher *m, globset *gs, guint position)
+{
+        if (m->kind == MATCHER_ANY || m->kind == MATCHER_REGEX
+            || !globset_add(gs, m->pattern, position))
+                return;
+
+        matcher_free(m);
+        m->kind = MATCHER_GLOBSET;
+        m->text = NULL;
+        m->len = 0;
+}
+
+static bool matcher_matches_globset(const struct matcher *m, const char *str,
+                                    const globset *gs, guint32 **bits,
+                                    guint position)
+{
+        if (m->kind != MATCHER_GLOBSET)
+                return matcher_matches(m, str);
+
+        if (!*bits) {
+                *bits = g_new0(guint32, GLOBSET_WORDS(rule_index.n_rules));
+                globset_match(gs, str, *bits);
+        }
+
+        return GLOBSET_TEST(*bits, position);
+}
+
+static bool compiled_rule_matches(const struct compiled_rule *cr,
+                                  const notification *n,
+                                  struct rule_scan *scan)
+{
+        const rule_t *r = cr->rule;
+
+        return (r->match_transient == -1 || r->match_transient == n->transient)
+                && (r->msg_urgency == URG_NONE || r->msg_urgency == n->urgency)
+                && matcher_matches(&cr->appname, n->appname)
+                && matcher_matches(&cr->category, n->category)
+                && matcher_matches(&cr->icon, n->icon)
+                && matcher_matches_globset(&cr->summary, n->summary,
+                                           rule_index.summaries, &scan->summary,
+                                           cr->position)
+                && matcher_matches_globset(&cr->body, n->body,
+                                           rule_index.bodies, &scan->body,
+                                           cr->position);
+}
+
+static void rule_index_add(GHashTable *table, const char *key, struct compiled_rule *cr)
+{
+        GPtrArray *bucket = g_hash_table_lookup(table, key);
+
+        if (!bucket) {
+                bucket = g_ptr_array_new();
+                g_hash_table_insert(table, (gpointer) key, bucket);
+        }
+        g_ptr_array_add(bucket, cr);
+}
+
+static void rule_index_free(void)
+{
+        if (rule_index.by_appname)
+                g_hash_table_destroy(rule_index.by_appname);
+        if (rule_index.by_category)
+                g_hash_table_destroy(rule_index.by_category);
+        if (rule_index.generic)
+                g_ptr_array_free(rule_index.generic, TRUE);
+        globset_free(rule_index.summaries);
+        globset_free(rule_index.bodies);
+        for (guint i = 0; i < rule_index.n_rules; i++) {
+                struct compiled_rule *cr = &rule_index.rules[i];
+                matcher_free(&cr->appname);
+                matcher_free(&cr->summary);
+                matcher_free(&cr->body);
+                matcher_free(&cr->icon);
+                matcher_free(&cr->category);
+        }
+        g_free(rule_index.rules);
+
+        memset(&rule_index, 0, sizeof(rule_index));
+}
+
+static guint rule_memo_key_hash(gconstpointer data)
+{
+        const struct rule_memo_key *k = data;
+        guint hash = k->urgency * 2 + k->transient;
+
+        hash = hash * 31 + (k->appname ? g_str_hash(k->appname) : 0);
+        hash = hash * 31 + (k->category ? g_str_hash(k->category) : 0);
+        hash = hash * 31 + (k->icon ? g_str_hash(k->icon) : 0);
+
+        return hash;
+}
+
+static gboolean rule_memo_key_equal(gconstpointer a, gconstpointer b)
+{
+        const struct rule_memo_key *ka = a;
+        const struct rule_memo_key *kb = b;
+
+        return ka->urgency == kb->urgency
+            && ka->transient == kb->transient
+            && g_strcmp0(ka->appname, kb->appname) == 0
+            && g_strcmp0(ka->category, kb->category) == 0
+            && g_strcmp0(ka->icon, kb->icon) == 0;
+}
+
+static void rule_memo_free(gpointer data)
+{
+        struct rule_memo *memo = data;
+
+        intern_release(memo->key.appname);
+        intern_release(memo->key.category);
+        intern_release(memo->key.icon);
+        g_free(memo);
+}
+
+/*
+ * Remember the matches of the rules without summary and body filters for
+ * the attributes of the notification.
+ */
+static void rule_memo_insert(const struct rule_memo_key *key, GPtrArray *matches)
+{
+        if (!rule_memos)
+                rule_memos = g_hash_table_new_full(rule_memo_key_hash,
+                                                   rule_memo_key_equal,
+                                                   NULL, rule_memo_free);
+        else if (g_hash_table_size(rule_memos) >= RULE_MEMO_MAX)
+                g_hash_table_remove_all(rule_memos);
+
+        struct rule_memo *memo = g_malloc(sizeof(struct rule_memo)
+                                          + matches->len * sizeof(struct compiled_rule *));
+
+        memo->key.appname = intern(key->appname);
+        memo->key.category = intern(key->category);
+        memo->key.icon = intern(key->icon);
+        memo->key.urgency = key->urgency;
+        memo->key.transient = key->transient;
+        memo->n_rules = matches->len;
+        for (guint i = 0; i < matches->len; i++)
+                memo->rules[i] = g_ptr_array_index(matches, i);
+
+        g_hash_table_insert(rule_memos, &memo->key, memo);
+}
+
+/*
+ * Check if applying the rule changes the attributes of a memo key.
+ */
+static bool rule_modifies_memo_key(const rule_t *r)
+{
+        return r->urgency != URG_NONE || r->new_icon || r->set_transient != -1;
+}
+
+/* see rules.h */
+const struct rule_memo_stats *rules_get_memo_stats(void)
+{
+        return &memo_stats;
+}
+
+/* see rules.h */
+const struct rule_stats *rules_get_total_stats(void)
+{
+        return &total_stats;
+}
+
+/*
+ * A cheap monotonic timestamp in nanoseconds for the profiling counters
+ *
+ * Reading the clock costs more than matching most rules, so it only
+ * gets read with settings.rule_timing enabled.
+ */
+static inline guint64 rules_clock_ns(void)
+{
+        if (!settings.rule_timing)
+                return 0;
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/* see rules.h */
+void rules_compile(void)
+{
+        rule_index_free();
+
+        /* the memos point into the old rule index */
+        if (rule_memos)
+                g_hash_table_remove_all(rule_memos);
+
+        rule_index.n_rules = g_slist_length(rules);
+        rule_index.rules = g_new0(struct compiled_rule, rule_index.n_rules);
+        rule_index.by_appname = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                      NULL, (GDestroyNotify) g_ptr_array_unref);
+        rule_index.by_category = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                       NULL, (GDestroyNotify) g_ptr_array_unref);
+        rule_index.generic = g_ptr_array_new();
+        rule_index.summaries = globset_new();
+        rule_index.bodies = globset_new();
+
+        guint position = 0;
+        for (GSList *iter = rules; iter; iter = iter->next, position++) {
+                struct compiled_rule *cr = &rule_index.rules[position];
+                rule_t *r = iter->data;
+
+                cr->rule = r;
+                cr->position = position;
+                if (r->match_type == MATCH_REGEX) {
+                        matcher_compile_regex(&cr->appname, r->appname, r->appname_regex);
+                        matcher_compile_regex(&cr->summary, r->summary, r->summary_regex);
+                        matcher_compile_regex(&cr->body, r->body, r->body_regex);
+                        matcher_compile_regex(&cr->icon, r->icon, r->icon_regex);
+                        matcher_compile_regex(&cr->category, r->category, r->category_regex);
+                } else {
+                        matcher_compile(&cr->appname, r->appname);
+                        matcher_compile(&cr->summary, r->summary);
+                        matcher_compile(&cr->body, r->body);
+                        matcher_compile(&cr->icon, r->icon);
+                        matcher_compile(&cr->category, r->category);
+                }
+                matcher_compile_globset(&cr->summary, rule_index.summaries, position);
+                matcher_compile_globset(&cr->body, rule_index.bodies, position);
+                cr->content = cr->summary.kind != MATCHER_ANY || cr->body.kind != MATCHER_ANY;
+
+                if (cr->appname.kind == MATCHER_LITERAL)
+                        rule_index_add(rule_index.by_appname, r->appname, cr);
+                else if (cr->category.kind == MATCHER_LITERAL)
+                        rule_index_add(rule_index.by_category, r->category, cr);
+                else
+                        g_ptr_array_add(rule_index.generic, cr);
+        }
+
+        globset_build(rule_index.summaries);
+        globset_build(rule_index.bodies);
+}
 
 /*
  * Apply rule to notification.
@@ -25,18 +479,18 @@ void rule_apply(rule_t *r, notification *n)
         if (r->markup != MARKUP_NULL)
                 n->markup = r->markup;
         if (r->new_icon) {
-                g_free(n->icon);
-                n->icon = g_strdup(r->new_icon);
+                intern_release(n->icon);
+                n->icon = intern(r->new_icon);
                 rawimage_free(n->raw_icon);
                 n->raw_icon = NULL;
         }
         if (r->fg) {
-                g_free(n->colors[ColFG]);
-                n->colors[ColFG] = g_strdup(r->fg);
+                intern_release(n->colors[ColFG]);
+                n->colors[ColFG] = intern(r->fg);
         }
         if (r->bg) {
-                g_free(n->colors[ColBG]);
-                n->colors[ColBG] = g_strdup(r->bg);
+                intern_release(n->colors[ColBG]);
+                n->colors[ColBG] = intern(r->bg);
         }
         if (r->format)
                 n->format = r->format;
@@ -46,15 +500,118 @@ void rule_apply(rule_t *r, notification *n)
 
 /*
  * Check all rules if they match n and apply.
+ *
+ * Only the candidate rules of the compiled index are evaluated. Every
+ * rule sits in exactly one of the three candidate lists, which are each
+ * sorted by rule position, so merging them keeps the configured order
+ * and later rules still override earlier ones.
+ *
+ * The summary and body patterns of all rules are matched in a single pass
+ * over each text. Rules can't modify these fields, so the results stay
+ * valid while the rules get applied.
+ *
+ * The matches of the rules without summary and body filters only depend
+ * on the memo key, so they get remembered per key and only the content
+ * rules are evaluated for subsequent notifications with the same key. If
+ * a matching content rule changes one of the key attributes, the memo is
+ * not valid for the remaining rules anymore and they get evaluated.
+ *
+ * Every candidate rule counts an evaluation in its stats, including the
+ * ones decided by a memo. Only actual matching counts time, if
+ * settings.rule_timing is enabled.
  */
 void rule_apply_all(notification *n)
 {
-        for (GSList *iter = rules; iter; iter = iter->next) {
-                rule_t *r = iter->data;
-                if (rule_matches_notification(r, n)) {
-                        rule_apply(r, n);
+        guint64 start = rules_clock_ns();
+
+        if (!rule_index.generic)
+                rules_compile();
+
+        GPtrArray *lists[3] = {
+                rule_index.generic,
+                n->appname ? g_hash_table_lookup(rule_index.by_appname, n->appname) : NULL,
+                n->category ? g_hash_table_lookup(rule_index.by_category, n->category) : NULL,
+        };
+        guint pos[3] = { 0, 0, 0 };
+        struct rule_scan scan = { NULL, NULL };
+
+        struct rule_memo_key key = {
+                n->appname, n->category, n->icon, n->urgency, n->transient,
+        };
+        const struct rule_memo *memo = rule_memos ? g_hash_table_lookup(rule_memos, &key) : NULL;
+        GPtrArray *matches = NULL;
+        guint next_memo = 0;
+
+        if (memo) {
+                memo_stats.hits++;
+        } else {
+                memo_stats.misses++;
+                matches = g_ptr_array_new();
+        }
+
+        for (;;) {
+                struct compiled_rule *next = NULL;
+                int from = -1;
+
+                for (int i = 0; i < G_N_ELEMENTS(lists); i++) {
+                        if (!lists[i] || pos[i] >= lists[i]->len)
+                                continue;
+
+                        struct compiled_rule *cr = g_ptr_array_index(lists[i], pos[i]);
+                        if (!next || cr->position < next->position) {
+                                next = cr;
+                                from = i;
+                        }
+                }
+
+                if (!next)
+                        break;
+
+                pos[from]++;
+                next->rule->stats.evaluations++;
+
+                if (!next->content && memo) {
+                        if (next_memo < memo->n_rules && memo->rules[next_memo] == next) {
+                                next_memo++;
+                                next->rule->stats.matches++;
+                                total_stats.matches++;
+                                rule_apply(next->rule, n);
+                        }
+                        continue;
+                }
+
+                guint64 before = rules_clock_ns();
+                bool matched = compiled_rule_matches(next, n, &scan);
+                next->rule->stats.time_ns += rules_clock_ns() - before;
+
+                if (!matched)
+                        continue;
+
+                next->rule->stats.matches++;
+                total_stats.matches++;
+                rule_apply(next->rule, n);
+
+                if (!next->content) {
+                        if (matches)
+                                g_ptr_array_add(matches, next);
+                } else if (rule_modifies_memo_key(next->rule)) {
+                        memo = NULL;
+                        if (matches)
+                                g_ptr_array_free(matches, true);
+                        matches = NULL;
                 }
         }
+
+        if (matches) {
+                rule_memo_insert(&key, matches);
+                g_ptr_array_free(matches, true);
+        }
+
+        g_free(scan.summary);
+        g_free(scan.body);
+
+        total_stats.evaluations++;
+        total_stats.time_ns += rules_clock_ns() - start;
 }
 
 /*
@@ -69,6 +626,15 @@ void rule_init(rule_t *r)
         r->icon = NULL;
         r->category = NULL;
         r->msg_urgency = URG_NONE;
+        r->match_type = MATCH_GLOB;
+        r->appname_regex = NULL;
+        r->summary_regex = NULL;
+        r->body_regex = NULL;
+        r->icon_regex = NULL;
+        r->category_regex = NULL;
+        r->stats.evaluations = 0;
+        r->stats.matches = 0;
+        r->stats.time_ns = 0;
         r->timeout = -1;
         r->urgency = URG_NONE;
         r->fullscreen = FS_NULL;
@@ -82,17 +648,84 @@ void rule_init(rule_t *r)
         r->format = NULL;
 }
 
+/*
+ * Compile a single filter of a rule and report if it's invalid.
+ */
+static GRegex *rule_compile_regex(const rule_t *r, const char *field, const char *pattern)
+{
+        if (!pattern)
+                return NULL;
+
+        GError *err = NULL;
+        GRegex *regex = g_regex_new(pattern, G_REGEX_OPTIMIZE, 0, &err);
+
+        if (!regex) {
+                LOG_W("Rule '%s': Invalid %s regex '%s': %s. The rule will never match.",
+                      r->name ? r->name : "", field, pattern, err->message);
+                g_error_free(err);
+        }
+
+        return regex;
+}
+
+/* see rules.h */
+void rule_compile_regexes(rule_t *r)
+{
+        GRegex **regexes[] = {
+                &r->appname_regex, &r->summary_regex, &r->body_regex,
+                &r->icon_regex, &r->category_regex,
+        };
+
+        for (int i = 0; i < G_N_ELEMENTS(regexes); i++) {
+                if (*regexes[i])
+                        g_regex_unref(*regexes[i]);
+                *regexes[i] = NULL;
+        }
+
+        if (r->match_type != MATCH_REGEX)
+                return;
+
+        r->appname_regex = rule_compile_regex(r, "appname", r->appname);
+        r->summary_regex = rule_compile_regex(r, "summary", r->summary);
+        r->body_regex = rule_compile_regex(r, "body", r->body);
+        r->icon_regex = rule_compile_regex(r, "icon", r->icon);
+        r->category_regex = rule_compile_regex(r, "category", r->category);
+}
+
+/*
+ * Check a single filter of a MATCH_REGEX rule.
+ *
+ * A filter with an invalid expression never matches.
+ */
+static bool rule_regex_matches(const char *pattern, const GRegex *regex, const char *str)
+{
+        return !pattern || (regex && g_regex_match(regex, str ? str : "", 0, NULL));
+}
+
 /*
  * Check whether rule should be applied to n.
+ *
+ * The appname, icon and category patterns as well as the fields of
+ * initialized notifications are interned, so literal patterns match by
+ * their address without running fnmatch.
  */
 bool rule_matches_notification(rule_t *r, notification *n)
 {
-        return ((!r->appname || !fnmatch(r->appname, n->appname, 0))
+        if ((r->match_transient != -1 && r->match_transient != n->transient)
+            || (r->msg_urgency != URG_NONE && r->msg_urgency != n->urgency))
+                return false;
+
+        if (r->match_type == MATCH_REGEX)
+                return rule_regex_matches(r->appname, r->appname_regex, n->appname)
+                    && rule_regex_matches(r->summary, r->summary_regex, n->summary)
+                    && rule_regex_matches(r->body, r->body_regex, n->body)
+                    && rule_regex_matches(r->icon, r->icon_regex, n->icon)
+                    && rule_regex_matches(r->category, r->category_regex, n->category);
+
+        return ((!r->appname || r->appname == n->appname || !fnmatch(r->appname, n->appname, 0))
                 && (!r->summary || !fnmatch(r->summary, n->summary, 0))
                 && (!r->body || !fnmatch(r->body, n->body, 0))
-                && (!r->icon || !fnmatch(r->icon, n->icon, 0))
-                && (!r->category || !fnmatch(r->category, n->category, 0))
-                && (r->match_transient == -1 || (r->match_transient == n->transient))
-                && (r->msg_urgency == URG_NONE || r->msg_urgency == n->urgency));
+                && (!r->icon || r->icon == n->icon || !fnmatch(r->icon, n->icon, 0))
+                && (!r->category || r->category == n->category || !fnmatch(r->category, n->category, 0)));
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -8,6 +8,17 @@
 #include "notification.h"
 #include "settings.h"
 
+enum rule_match_type { MATCH_GLOB, MATCH_REGEX };
+
+/**
+ * Profiling counters of a rule
+ */
+struct rule_stats {
+        guint64 evaluations; /**< notifications the rule was a candidate for */
+        guint64 matches;     /**< notifications the rule got applied to */
+        guint64 time_ns;     /**< time spent matching the rule */
+};
+
 typedef struct _rule_t {
         char *name;
         /* filters */
@@ -17,6 +28,14 @@ typedef struct _rule_t {
         char *icon;
         char *category;
         int msg_urgency;
+        enum rule_match_type match_type;
+
+        /* the compiled filters for MATCH_REGEX, NULL if invalid or unset */
+        GRegex *appname_regex;
+        GRegex *summary_regex;
+        GRegex *body_regex;
+        GRegex *icon_regex;
+        GRegex *category_regex;
 
         /* actions */
         gint64 timeout;
@@ -31,6 +50,8 @@ typedef struct _rule_t {
         const char *format;
         const char *script;
         enum behavior_fullscreen fullscreen;
+
+        struct rule_stats stats;
 } rule_t;
 
 extern GSList *rules;
@@ -38,7 +59,46 @@ extern GSList *rules;
 void rule_init(rule_t *r);
 void rule_apply(rule_t *r, notification *n);
 void rule_apply_all(notification *n);
+
+/**
+ * Compile the filters of a rule with MATCH_REGEX into regular expressions
+ *
+ * Invalid expressions get reported once and never match. Rules with
+ * MATCH_GLOB release their previously compiled expressions.
+ */
+void rule_compile_regexes(rule_t *r);
 bool rule_matches_notification(rule_t *r, notification *n);
 
+/**
+ * Precompile the patterns of all rules and index them by their literal
+ * appname or category.
+ *
+ * Has to be called again after the rules list changed, rule_apply_all()
+ * only compiles the rules on its own if they were never compiled before.
+ * Compiling drops all memos of rule matches.
+ */
+void rules_compile(void);
+
+/**
+ * The effectiveness of the rule memos
+ */
+struct rule_memo_stats {
+        guint64 hits;   /**< notifications, which reused the matches of a memo */
+        guint64 misses; /**< notifications, which had to evaluate all rules */
+};
+
+/**
+ * @return the counters of the rule memos since the start of dunst
+ */
+const struct rule_memo_stats *rules_get_memo_stats(void);
+
+/**
+ * Get the counters of rule_apply_all() itself
+ *
+ * The evaluations are the processed notifications, the matches the
+ * applied rules and the time is the whole time spent applying rules.
+ */
+const struct rule_stats *rules_get_total_stats(void);
+
 #endif
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -13,6 +13,8 @@
 #include "rules.h" // put before config.h to fix missing include
 #include "config.h"
 #include "dunst.h"
+#include "format.h"
+#include "intern.h"
 #include "log.h"
 #include "notification.h"
 #include "option_parser.h"
@@ -48,6 +50,18 @@ static enum markup_mode parse_markup_mode(const char *mode)
         }
 }
 
+static enum rule_match_type parse_match_type(const char *type)
+{
+        if (strcmp(type, "glob") == 0) {
+                return MATCH_GLOB;
+        } else if (strcmp(type, "regex") == 0) {
+                return MATCH_REGEX;
+        } else {
+                LOG_W("Unknown match type: '%s'", type);
+                return MATCH_GLOB;
+        }
+}
+
 static enum urgency ini_get_urgency(const char *section, const char *key, const int def)
 {
         int ret = def;
@@ -172,6 +186,7 @@ void load_settings(char *cmdline_config_path)
                 "format", "-format", defaults.format,
                 "The format template for the notifications"
         );
+        format_compile(settings.format);
 
         settings.sort = option_get_bool(
                 "global",
@@ -225,6 +240,18 @@ void load_settings(char *cmdline_config_path)
                 "Don't timeout notifications if user is longer idle than threshold"
         );
 
+        settings.max_frame_rate = option_get_int(
+                "global",
+                "max_frame_rate", "-max_frame_rate", defaults.max_frame_rate,
+                "Maximum amount of redraws per second, 0 for no limit"
+        );
+
+        settings.rule_timing = option_get_bool(
+                "global",
+                "rule_timing", "-rule_timing", defaults.rule_timing,
+                "Measure the time spent matching each rule"
+        );
+
         settings.monitor = option_get_int(
                 "global",
                 "monitor", "-mon/-monitor", defaults.monitor,
@@ -457,6 +484,18 @@ void load_settings(char *cmdline_config_path)
                 "paths to default icons"
         );
 
+        settings.icon_cache_entries = option_get_int(
+                "global",
+                "icon_cache_entries", "-icon_cache_entries", defaults.icon_cache_entries,
+                "Number of loaded icons to keep, set to 0 to disable the cache"
+        );
+
+        settings.icon_cache_size = option_get_int(
+                "global",
+                "icon_cache_size", "-icon_cache_size", defaults.icon_cache_size,
+                "Memory for the cached icons in kilobytes"
+        );
+
         {
                 // Backwards compatibility with the legacy 'frame' section.
                 if (ini_is_set("frame", "width")) {
@@ -623,7 +662,13 @@ void load_settings(char *cmdline_config_path)
 
         /* push hardcoded default rules into rules list */
         for (int i = 0; i < G_N_ELEMENTS(default_rules); i++) {
-                rules = g_slist_insert(rules, &(default_rules[i]), -1);
+                rule_t *r = &(default_rules[i]);
+                r->appname = intern(r->appname);
+                r->icon = intern(r->icon);
+                r->category = intern(r->category);
+                if (r->format)
+                        format_compile(r->format);
+                rules = g_slist_insert(rules, r, -1);
         }
 
         const char *cur_section = NULL;
@@ -656,13 +701,26 @@ void load_settings(char *cmdline_config_path)
                 }
 
                 r->name = g_strdup(cur_section);
-                r->appname = ini_get_string(cur_section, "appname", r->appname);
+                r->appname = intern_take(ini_get_string(cur_section, "appname", r->appname));
                 r->summary = ini_get_string(cur_section, "summary", r->summary);
                 r->body = ini_get_string(cur_section, "body", r->body);
-                r->icon = ini_get_string(cur_section, "icon", r->icon);
-                r->category = ini_get_string(cur_section, "category", r->category);
+                r->icon = intern_take(ini_get_string(cur_section, "icon", r->icon));
+                r->category = intern_take(ini_get_string(cur_section, "category", r->category));
                 r->timeout = ini_get_time(cur_section, "timeout", r->timeout);
 
+                {
+                        char *c = ini_get_string(
+                                cur_section,
+                                "match_type", NULL
+                        );
+
+                        if (c != NULL) {
+                                r->match_type = parse_match_type(c);
+                                g_free(c);
+                        }
+                }
+                rule_compile_regexes(r);
+
                 {
                         char *c = ini_get_string(
                                 cur_section,
@@ -680,6 +738,8 @@ void load_settings(char *cmdline_config_path)
                 r->fg = ini_get_string(cur_section, "foreground", r->fg);
                 r->bg = ini_get_string(cur_section, "background", r->bg);
                 r->format = ini_get_string(cur_section, "format", r->format);
+                if (r->format)
+                        format_compile(r->format);
                 r->new_icon = ini_get_string(cur_section, "new_icon", r->new_icon);
                 r->history_ignore = ini_get_bool(cur_section, "history_ignore", r->history_ignore);
                 r->match_transient = ini_get_bool(cur_section, "match_transient", r->match_transient);
@@ -696,6 +756,8 @@ void load_settings(char *cmdline_config_path)
                 r->script = ini_get_path(cur_section, "script", NULL);
         }
 
+        rules_compile();
+
 #ifndef STATIC_CONFIG
         if (config_file) {
                 fclose(config_file);
@@ -41,6 +41,8 @@ typedef struct _settings {
         int indicate_hidden;
         gint64 idle_threshold;
         gint64 show_age_threshold;
+        int max_frame_rate;
+        bool rule_timing;
         enum alignment align;
         int sticky_history;
         int history_length;
@@ -65,6 +67,8 @@ typedef struct _settings {
         enum icon_position_t icon_position;
         int max_icon_size;
         char *icon_path;
+        int icon_cache_entries;
+        int icon_cache_size;
         enum follow_mode f_mode;
         bool always_run_script;
         keyboard_shortcut close_ks;
@@ -166,4 +166,16 @@ gint64 string_to_time(const char *string)
                 return 0;
 }
 
+/* see utils.h */
+gint64 frame_delay(gint64 now, gint64 last_frame, int max_frame_rate)
+{
+        if (max_frame_rate <= 0)
+                return 0;
+
+        gint64 frame = G_USEC_PER_SEC / max_frame_rate;
+        gint64 delay = last_frame + frame - now;
+
+        return CLAMP(delay, 0, frame);
+}
+
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -27,5 +27,9 @@ char *string_to_path(char *string);
 /* convert time units (ms, s, m) to internal gint64 microseconds */
 gint64 string_to_time(const char *string);
 
+/* microseconds to wait at <now> for the next frame after <last_frame>,
+ * at most one frame and 0 if <max_frame_rate> is not positive */
+gint64 frame_delay(gint64 now, gint64 last_frame, int max_frame_rate);
+
 #endif
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
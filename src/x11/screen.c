@@ -142,12 +142,16 @@ static int autodetect_dpi(screen_info *scr)
         return (double)scr->dim.h * 25.4 / (double)scr->dim.mmh;
 }
 
-void screen_check_event(XEvent event)
+/* see screen.h */
+bool screen_check_event(XEvent event)
 {
-        if (event.type == randr_event_base + RRScreenChangeNotify)
+        if (event.type == randr_event_base + RRScreenChangeNotify) {
                 randr_update();
-        else
-                LOG_D("XEvent: Ignored '%d'", event.type);
+                return true;
+        }
+
+        LOG_D("XEvent: Ignored '%d'", event.type);
+        return false;
 }
 
 void xinerama_update(void)
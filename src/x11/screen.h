@@ -23,7 +23,13 @@ typedef struct _screen_info {
 } screen_info;
 
 void init_screens(void);
-void screen_check_event(XEvent event);
+
+/**
+ * Update the screens, if the event reports a change of them
+ *
+ * @return true, if the screens got updated
+ */
+bool screen_check_event(XEvent event);
 
 screen_info *get_active_screen(void);
 double get_dpi_for_screen(screen_info *scr);
@@ -9,7 +9,6 @@
 #include <assert.h>
 #include <cairo-xlib.h>
 #include <cairo.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <locale.h>
 #include <math.h>
@@ -26,6 +25,7 @@
 
 #include "src/dbus.h"
 #include "src/dunst.h"
+#include "src/icon.h"
 #include "src/log.h"
 #include "src/markup.h"
 #include "src/notification.h"
@@ -57,11 +57,25 @@ typedef struct _colored_layout {
         PangoAttrList *attr;
         cairo_surface_t *icon;
         notification *n;
+
+        /* what the layout got created from, to tell when to rebuild it */
+        char *source;              /**< the markup passed to the layout */
+        char *icon_name;           /**< the icon of the notification */
+        const RawImage *raw_icon;  /**< the raw icon of the notification */
 } colored_layout;
 
 cairo_ctx_t cairo_ctx;
 static bool fullscreen_last = false;
 
+/**
+ * The PangoContext shared by all layouts
+ */
+static struct {
+        PangoContext *context;
+        int screen;  /**< the screen_info.scr it got last used on */
+        double dpi;  /**< the resolution of the context */
+} pango_ctx = { NULL, -1, 0 };
+
 /* FIXME refactor setup teardown handlers into one setup and one teardown */
 static void x_shortcut_setup_error_handler(void);
 static int x_shortcut_tear_down_error_handler(void);
@@ -172,12 +186,17 @@ static void r_setup_pango_layout(PangoLayout *layout, int width)
 
 }
 
-static void free_colored_layout(void *data)
+/* see x.h */
+void x_layout_free(colored_layout *cl)
 {
-        colored_layout *cl = data;
+        if (!cl)
+                return;
+
         g_object_unref(cl->l);
         pango_attr_list_unref(cl->attr);
         g_free(cl->text);
+        g_free(cl->source);
+        g_free(cl->icon_name);
         if (cl->icon) cairo_surface_destroy(cl->icon);
         g_free(cl);
 }
@@ -187,16 +206,6 @@ static bool have_dynamic_width(void)
         return (xctx.geometry.mask & WidthValue && xctx.geometry.w == 0);
 }
 
-static bool does_file_exist(const char *filename)
-{
-        return (access(filename, F_OK) != -1);
-}
-
-static bool is_readable_file(const char *filename)
-{
-        return (access(filename, R_OK) != -1);
-}
-
 const char *get_filename_ext(const char *filename)
 {
         const char *dot = strrchr(filename, '.');
@@ -287,141 +296,72 @@ static dimension_t calculate_dimensions(GSList *layouts)
         return dim;
 }
 
-static cairo_status_t read_from_buf(void *closure, unsigned char *data, unsigned int size)
-{
-        GByteArray *buf = (GByteArray *)closure;
-
-        unsigned int cpy = MIN(size, buf->len);
-        memcpy(data, buf->data, cpy);
-        g_byte_array_remove_range(buf, 0, cpy);
-
-        return CAIRO_STATUS_SUCCESS;
-}
-
-
-static cairo_surface_t *gdk_pixbuf_to_cairo_surface(GdkPixbuf *pixbuf)
-{
-        /*
-         * Export the gdk pixbuf into buffer as a png and import the png buffer
-         * via cairo again as a cairo_surface_t.
-         * It looks counterintuitive, as there is gdk_cairo_set_source_pixbuf,
-         * which does the job faster. But this would require gtk3 as a dependency
-         * for a single function call. See discussion in #334 and #376.
-         */
-        cairo_surface_t *icon_surface = NULL;
-        GByteArray *buffer;
-        char *bufstr;
-        gsize buflen;
-
-        gdk_pixbuf_save_to_buffer(pixbuf, &bufstr, &buflen, "png", NULL, NULL);
-
-        buffer = g_byte_array_new_take((guint8*)bufstr, buflen);
-        icon_surface = cairo_image_surface_create_from_png_stream(read_from_buf, buffer);
-
-        g_byte_array_free(buffer, TRUE);
-
-        return icon_surface;
-}
-
-static GdkPixbuf *get_pixbuf_from_file(const char *icon_path)
+/*
+ * Drop the shared PangoContext, so that it gets set up again on the
+ * next redraw. Layouts still using the old one get rebuilt.
+ */
+static void r_pango_context_reset(void)
 {
-        GdkPixbuf *pixbuf = NULL;
-        if (is_readable_file(icon_path)) {
-                GError *error = NULL;
-                pixbuf = gdk_pixbuf_new_from_file(icon_path, &error);
-                if (pixbuf == NULL)
-                        g_free(error);
-        }
-        return pixbuf;
+        if (pango_ctx.context)
+                g_object_unref(pango_ctx.context);
+        pango_ctx.context = NULL;
+        pango_ctx.screen = -1;
 }
 
-static GdkPixbuf *get_pixbuf_from_path(char *icon_path)
+/*
+ * Get the PangoContext for the layouts on the active screen.
+ *
+ * The context only gets created again, when the active screen has
+ * a different resolution, so that pango keeps its caches warm.
+ */
+static PangoContext *r_get_pango_context(cairo_t *c)
 {
-        GdkPixbuf *pixbuf = NULL;
-        gchar *uri_path = NULL;
-        if (strlen(icon_path) > 0) {
-                if (g_str_has_prefix(icon_path, "file://")) {
-                        uri_path = g_filename_from_uri(icon_path, NULL, NULL);
-                        if (uri_path != NULL) {
-                                icon_path = uri_path;
-                        }
-                }
-                /* absolute path? */
-                if (icon_path[0] == '/' || icon_path[0] == '~') {
-                        pixbuf = get_pixbuf_from_file(icon_path);
-                }
-                /* search in icon_path */
-                if (pixbuf == NULL) {
-                        char *start = settings.icon_path,
-                             *end, *current_folder, *maybe_icon_path;
-                        do {
-                                end = strchr(start, ':');
-                                if (end == NULL) end = strchr(settings.icon_path, '\0'); /* end = end of string */
-
-                                current_folder = g_strndup(start, end - start);
-                                /* try svg */
-                                maybe_icon_path = g_strconcat(current_folder, "/", icon_path, ".svg", NULL);
-                                if (!does_file_exist(maybe_icon_path)) {
-                                        g_free(maybe_icon_path);
-                                        /* fallback to png */
-                                        maybe_icon_path = g_strconcat(current_folder, "/", icon_path, ".png", NULL);
-                                }
-                                g_free(current_folder);
+        screen_info *screen = get_active_screen();
 
-                                pixbuf = get_pixbuf_from_file(maybe_icon_path);
-                                g_free(maybe_icon_path);
-                                if (pixbuf != NULL) {
-                                        return pixbuf;
-                                }
+        if (pango_ctx.context && pango_ctx.screen == screen->scr)
+                return pango_ctx.context;
 
-                                start = end + 1;
-                        } while (*(end) != '\0');
-                }
-                if (pixbuf == NULL) {
-                        LOG_W("Could not load icon: '%s'", icon_path);
-                }
-                if (uri_path != NULL) {
-                        g_free(uri_path);
-                }
+        double dpi = get_dpi_for_screen(screen);
+        if (!pango_ctx.context || pango_ctx.dpi != dpi) {
+                r_pango_context_reset();
+                pango_ctx.context = pango_cairo_create_context(c);
+                pango_cairo_context_set_resolution(pango_ctx.context, dpi);
+                pango_ctx.dpi = dpi;
         }
-        return pixbuf;
-}
+        pango_ctx.screen = screen->scr;
 
-static GdkPixbuf *get_pixbuf_from_raw_image(const RawImage *raw_image)
-{
-        GdkPixbuf *pixbuf = NULL;
-
-        pixbuf = gdk_pixbuf_new_from_data(raw_image->data,
-                                          GDK_COLORSPACE_RGB,
-                                          raw_image->has_alpha,
-                                          raw_image->bits_per_sample,
-                                          raw_image->width,
-                                          raw_image->height,
-                                          raw_image->rowstride,
-                                          NULL,
-                                          NULL);
-
-        return pixbuf;
+        return pango_ctx.context;
 }
 
-static PangoLayout *create_layout(cairo_t *c)
+/*
+ * Update the parts of the layout, which don't need the text to be
+ * parsed again: the colors and the width.
+ */
+static void r_update_shared(colored_layout *cl, notification *n)
 {
-        screen_info *screen = get_active_screen();
-
-        PangoContext *context = pango_cairo_create_context(c);
-        pango_cairo_context_set_resolution(context, get_dpi_for_screen(screen));
+        cl->fg = x_string_to_color_t(n->colors[ColFG]);
+        cl->bg = x_string_to_color_t(n->colors[ColBG]);
+        cl->frame = x_string_to_color_t(n->colors[ColFrame]);
 
-        PangoLayout *layout = pango_layout_new(context);
+        cl->n = n;
 
-        g_object_unref(context);
+        dimension_t dim = calculate_dimensions(NULL);
+        int width = dim.w;
 
-        return layout;
+        if (have_dynamic_width()) {
+                r_setup_pango_layout(cl->l, -1);
+        } else {
+                width -= 2 * settings.h_padding;
+                width -= 2 * settings.frame_width;
+                if (cl->icon) width -= cairo_image_surface_get_width(cl->icon) + settings.h_padding;
+                r_setup_pango_layout(cl->l, width);
+        }
 }
 
-static colored_layout *r_init_shared(cairo_t *c, notification *n)
+static colored_layout *r_init_shared(PangoContext *context, notification *n)
 {
-        colored_layout *cl = g_malloc(sizeof(colored_layout));
-        cl->l = create_layout(c);
+        colored_layout *cl = g_malloc0(sizeof(colored_layout));
+        cl->l = pango_layout_new(context);
 
         if (!settings.word_wrap) {
                 PangoEllipsizeMode ellipsize;
@@ -441,42 +381,15 @@ static colored_layout *r_init_shared(cairo_t *c, notification *n)
                 pango_layout_set_ellipsize(cl->l, ellipsize);
         }
 
-        GdkPixbuf *pixbuf = NULL;
-
-        if (n->raw_icon &&
-            settings.icon_position != icons_off) {
-
-                pixbuf = get_pixbuf_from_raw_image(n->raw_icon);
-
-        } else if (n->icon && settings.icon_position != icons_off) {
-                pixbuf = get_pixbuf_from_path(n->icon);
-        }
-
-        if (pixbuf != NULL) {
-                int w = gdk_pixbuf_get_width(pixbuf);
-                int h = gdk_pixbuf_get_height(pixbuf);
-                int larger = w > h ? w : h;
-                if (settings.max_icon_size && larger > settings.max_icon_size) {
-                        GdkPixbuf *scaled;
-                        if (w >= h) {
-                                scaled = gdk_pixbuf_scale_simple(pixbuf,
-                                                settings.max_icon_size,
-                                                (int) ((double) settings.max_icon_size / w * h),
-                                                GDK_INTERP_BILINEAR);
-                        } else {
-                                scaled = gdk_pixbuf_scale_simple(pixbuf,
-                                                (int) ((double) settings.max_icon_size / h * w),
-                                                settings.max_icon_size,
-                                                GDK_INTERP_BILINEAR);
-                        }
-                        g_object_unref(pixbuf);
-                        pixbuf = scaled;
-                }
+        cl->icon = NULL;
+        cl->icon_name = g_strdup(n->icon);
+        cl->raw_icon = n->raw_icon;
 
-                cl->icon = gdk_pixbuf_to_cairo_surface(pixbuf);
-                g_object_unref(pixbuf);
-        } else {
-                cl->icon = NULL;
+        if (settings.icon_position != icons_off) {
+                if (n->raw_icon)
+                        cl->icon = icon_get_for_raw_image(n->raw_icon, settings.max_icon_size);
+                else if (n->icon)
+                        cl->icon = icon_get_for_path(n->icon, settings.max_icon_size);
         }
 
         if (cl->icon && cairo_surface_status(cl->icon) != CAIRO_STATUS_SUCCESS) {
@@ -484,61 +397,82 @@ static colored_layout *r_init_shared(cairo_t *c, notification *n)
                 cl->icon = NULL;
         }
 
-        cl->fg = x_string_to_color_t(n->colors[ColFG]);
-        cl->bg = x_string_to_color_t(n->colors[ColBG]);
-        cl->frame = x_string_to_color_t(n->colors[ColFrame]);
+        r_update_shared(cl, n);
 
-        cl->n = n;
+        return cl;
+}
 
-        dimension_t dim = calculate_dimensions(NULL);
-        int width = dim.w;
+/*
+ * Check, if the layout retained for the notification still shows the
+ * given text with the current icon and PangoContext.
+ *
+ * An icon loaded from a path is current as long as the icon cache didn't
+ * reload it, e.g. because its file changed.
+ */
+static bool r_layout_is_current(const colored_layout *cl, const notification *n, const char *text, PangoContext *context)
+{
+        if (!cl
+            || pango_layout_get_context(cl->l) != context
+            || cl->raw_icon != n->raw_icon
+            || g_strcmp0(cl->icon_name, n->icon) != 0
+            || g_strcmp0(cl->source, text) != 0)
+                return false;
 
-        if (have_dynamic_width()) {
-                r_setup_pango_layout(cl->l, -1);
-        } else {
-                width -= 2 * settings.h_padding;
-                width -= 2 * settings.frame_width;
-                if (cl->icon) width -= cairo_image_surface_get_width(cl->icon) + settings.h_padding;
-                r_setup_pango_layout(cl->l, width);
-        }
+        if (settings.icon_position != icons_off && !n->raw_icon && n->icon)
+                return icon_is_current(n->icon, settings.max_icon_size, cl->icon);
 
-        return cl;
+        return true;
 }
 
-static colored_layout *r_create_layout_for_xmore(cairo_t *c, notification *n, int qlen)
+static colored_layout *r_create_layout_for_xmore(PangoContext *context, notification *n, int qlen)
 {
-        colored_layout *cl = r_init_shared(c, n);
+        colored_layout *cl = r_init_shared(context, n);
         cl->text = g_strdup_printf("(%d more)", qlen);
         cl->attr = NULL;
         pango_layout_set_text(cl->l, cl->text, -1);
         return cl;
 }
 
-static colored_layout *r_create_layout_from_notification(cairo_t *c, notification *n)
+/*
+ * Get the layout to draw the notification with the given text.
+ *
+ * The layout is retained in the notification and only gets rebuilt,
+ * when its text, icon or the PangoContext changed.
+ */
+static colored_layout *r_create_layout_from_notification(PangoContext *context, notification *n, const char *text)
 {
+        colored_layout *cl = n->layout;
+
+        if (r_layout_is_current(cl, n, text, context)) {
+                r_update_shared(cl, n);
+                goto out;
+        }
 
-        colored_layout *cl = r_init_shared(c, n);
+        notification_release_layout(n);
+        cl = n->layout = r_init_shared(context, n);
+        cl->source = g_strdup(text);
 
         /* markup */
         GError *err = NULL;
-        pango_parse_markup(n->text_to_render, -1, 0, &(cl->attr), &(cl->text), NULL, &err);
+        pango_parse_markup(text, -1, 0, &(cl->attr), &(cl->text), NULL, &err);
 
         if (!err) {
                 pango_layout_set_text(cl->l, cl->text, -1);
                 pango_layout_set_attributes(cl->l, cl->attr);
         } else {
                 /* remove markup and display plain message instead */
-                n->text_to_render = markup_strip(n->text_to_render);
+                char *plain = markup_strip(g_strdup(text));
                 cl->text = NULL;
                 cl->attr = NULL;
-                pango_layout_set_text(cl->l, n->text_to_render, -1);
+                pango_layout_set_text(cl->l, plain, -1);
+                g_free(plain);
                 if (n->first_render) {
                         LOG_W("Unable to parse markup: %s", err->message);
                 }
                 g_error_free(err);
         }
 
-
+out:
         pango_layout_get_pixel_size(cl->l, NULL, &(n->displayed_height));
         if (cl->icon) n->displayed_height = MAX(cairo_image_surface_get_height(cl->icon), n->displayed_height);
         n->displayed_height = MAX(settings.notification_height, n->displayed_height + settings.padding * 2);
@@ -550,6 +484,7 @@ static colored_layout *r_create_layout_from_notification(cairo_t *c, notificatio
 static GSList *r_create_layouts(cairo_t *c)
 {
         GSList *layouts = NULL;
+        PangoContext *context = r_get_pango_context(c);
 
         int qlen = queues_length_waiting();
         bool xmore_is_needed = qlen > 0 && settings.indicate_hidden;
@@ -564,18 +499,20 @@ static GSList *r_create_layouts(cairo_t *c)
                 notification_update_text_to_render(n);
 
                 if (!iter->next && xmore_is_needed && xctx.geometry.h == 1) {
-                        char *new_ttr = g_strdup_printf("%s (%d more)", n->text_to_render, qlen);
-                        g_free(n->text_to_render);
-                        n->text_to_render = new_ttr;
+                        char *text = g_strdup_printf("%s (%d more)", n->text_to_render, qlen);
+                        layouts = g_slist_append(layouts,
+                                        r_create_layout_from_notification(context, n, text));
+                        g_free(text);
+                } else {
+                        layouts = g_slist_append(layouts,
+                                        r_create_layout_from_notification(context, n, n->text_to_render));
                 }
-                layouts = g_slist_append(layouts,
-                                r_create_layout_from_notification(c, n));
         }
 
         if (xmore_is_needed && xctx.geometry.h != 1) {
                 /* append xmore message as new message */
                 layouts = g_slist_append(layouts,
-                        r_create_layout_for_xmore(c, last, qlen));
+                        r_create_layout_for_xmore(context, last, qlen));
         }
 
         return layouts;
@@ -583,7 +520,14 @@ static GSList *r_create_layouts(cairo_t *c)
 
 static void r_free_layouts(GSList *layouts)
 {
-        g_slist_free_full(layouts, free_colored_layout);
+        for (GSList *iter = layouts; iter; iter = iter->next) {
+                colored_layout *cl = iter->data;
+
+                /* only the xmore layout isn't retained by its notification */
+                if (cl->n->layout != cl)
+                        x_layout_free(cl);
+        }
+        g_slist_free(layouts);
 }
 
 static dimension_t x_render_layout(cairo_t *c, colored_layout *cl, colored_layout *cl_next, dimension_t dim, bool first, bool last)
@@ -928,7 +872,8 @@ gboolean x_mainloop_fd_dispatch(GSource *source, GSourceFunc callback, gpointer
                         }
                         break;
                 default:
-                        screen_check_event(ev);
+                        if (screen_check_event(ev))
+                                r_pango_context_reset();
                         break;
                 }
         }
@@ -986,6 +931,8 @@ static void x_handle_click(XEvent ev)
 
 void x_free(void)
 {
+        r_pango_context_reset();
+
         cairo_surface_destroy(cairo_ctx.surface);
         cairo_destroy(cairo_ctx.context);
 
@@ -43,8 +43,11 @@ typedef struct _color_t {
 
 extern xctx_t xctx;
 
+struct _colored_layout;
+
 /* window */
 void x_win_draw(void);
+void x_layout_free(struct _colored_layout *cl);
 void x_win_hide(void);
 void x_win_show(void);
 
@@ -0,0 +1,152 @@
+#include "greatest.h"
+#include "helpers.h"
+#include "src/dbus.h"
+#include "src/queues.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <string.h>
+
+static gint closed_signals;
+
+static GDBusMessage *test_count_closed(GDBusConnection *connection,
+                                       GDBusMessage *message,
+                                       gboolean incoming,
+                                       gpointer data)
+{
+        if (incoming && g_strcmp0(g_dbus_message_get_member(message),
+                                  "NotificationClosed") == 0)
+                g_atomic_int_inc(&closed_signals);
+
+        return message;
+}
+
+TEST test_dbus_raw_image_outlives_hint(void)
+{
+        const guchar pixels[] = {
+                0x10, 0x20, 0x30, 0xff,  0x40, 0x50, 0x60, 0x80,
+        };
+
+        GVariant *data = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
+                                                   pixels, sizeof(pixels), 1);
+        GVariant *hint = g_variant_ref_sink(g_variant_new("(iiibii@ay)",
+                                                          2, 1, 8, TRUE, 8, 4,
+                                                          data));
+
+        RawImage *image = get_raw_image_from_data_hint(hint);
+        g_variant_unref(hint);
+
+        ASSERT(image);
+        ASSERT_EQ(2, image->width);
+        ASSERT_EQ(1, image->height);
+        ASSERT_EQ(8, image->rowstride);
+        ASSERT_EQ(0, memcmp(image->data, pixels, sizeof(pixels)));
+
+        rawimage_free(image);
+        PASS();
+}
+
+TEST test_dbus_raw_image_bad_length(void)
+{
+        const guchar pixels[] = { 0x10, 0x20, 0x30, 0xff };
+
+        GVariant *data = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE,
+                                                   pixels, sizeof(pixels), 1);
+        GVariant *hint = g_variant_ref_sink(g_variant_new("(iiibii@ay)",
+                                                          2, 1, 8, TRUE, 8, 4,
+                                                          data));
+
+        ASSERT_FALSE(get_raw_image_from_data_hint(hint));
+
+        g_variant_unref(hint);
+        PASS();
+}
+
+TEST test_dbus_tear_down_flushes_signals(void)
+{
+        GDBusConnection *peer = test_dbus_connect();
+        ASSERT(peer);
+
+        g_atomic_int_set(&closed_signals, 0);
+        g_dbus_connection_add_filter(peer, test_count_closed, NULL, NULL);
+
+        /* Emitting schedules a single flush, which never gets to run */
+        notification *n = notification_create();
+        for (n->id = 1; n->id <= 50; n->id++)
+                signal_notification_closed(n, REASON_SIG);
+        notification_free(n);
+
+        dbus_tear_down(0);
+
+        /* The filter runs in the worker thread of the peer */
+        gint64 deadline = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+        while (g_atomic_int_get(&closed_signals) < 50
+               && g_get_monotonic_time() < deadline)
+                g_usleep(1000);
+
+        ASSERT_EQ(50, g_atomic_int_get(&closed_signals));
+
+        test_dbus_disconnect();
+        PASS();
+}
+
+static notification *test_received(const char *summary, guint32 replaces_id)
+{
+        notification *n = notification_create();
+        n->summary = g_strdup(summary);
+        n->body = g_strdup("");
+        n->format = "%s";
+        n->id = replaces_id;
+
+        return n;
+}
+
+TEST test_dbus_close_pending(void)
+{
+        ASSERT(test_dbus_connect());
+        queues_init();
+
+        /* Both calls arrive before the idle source processes the first */
+        guint32 id = dbus_queue_notification(test_received("Pending", 0));
+        dbus_close_notification(id);
+
+        ASSERT_FALSE(dbus_process_pending());
+        ASSERT_EQ(0, queues_length_waiting());
+        ASSERT_EQ(1, queues_length_history());
+        ASSERT_EQ(id, queues_get_history(0)->id);
+
+        teardown_queues();
+        test_dbus_disconnect();
+        PASS();
+}
+
+TEST test_dbus_replace_pending(void)
+{
+        ASSERT(test_dbus_connect());
+        queues_init();
+
+        guint32 id = dbus_queue_notification(test_received("Original", 0));
+        ASSERT_EQ(id, dbus_queue_notification(test_received("Replacement", id)));
+
+        ASSERT(dbus_process_pending());
+        ASSERT_EQ(1, queues_length_waiting());
+
+        dbus_close_notification(id);
+        ASSERT_EQ(0, queues_length_waiting());
+        ASSERT_EQ(1, queues_length_history());
+        ASSERT_STR_EQ("Replacement", queues_get_history(0)->summary);
+
+        teardown_queues();
+        test_dbus_disconnect();
+        PASS();
+}
+
+SUITE(suite_dbus)
+{
+        RUN_TEST(test_dbus_raw_image_outlives_hint);
+        RUN_TEST(test_dbus_raw_image_bad_length);
+        RUN_TEST(test_dbus_close_pending);
+        RUN_TEST(test_dbus_replace_pending);
+        RUN_TEST(test_dbus_tear_down_flushes_signals);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
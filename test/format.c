@@ -0,0 +1,85 @@
+#include "greatest.h"
+#include "src/format.h"
+#include "src/notification.h"
+
+#include <glib.h>
+#include <string.h>
+
+TEST test_format_compile(void)
+{
+        const format_template *t = format_compile("<b>%s</b>\\n%b %%%p");
+
+        ASSERT_EQ(t, format_compile("<b>%s</b>\\n%b %%%p"));
+
+        enum format_token_type types[] = {
+                FORMAT_LITERAL, FORMAT_SUMMARY, FORMAT_LITERAL,
+                FORMAT_BODY, FORMAT_LITERAL, FORMAT_PROGRESS,
+        };
+        const char *literals[] = { "<b>", NULL, "</b>\n", NULL, " %", NULL };
+
+        ASSERT_EQ(G_N_ELEMENTS(types), t->n_tokens);
+        for (int i = 0; i < G_N_ELEMENTS(types); i++) {
+                ASSERT_EQ(types[i], t->tokens[i].type);
+                if (literals[i]) {
+                        ASSERT_EQ(strlen(literals[i]), t->tokens[i].len);
+                        ASSERT_STRN_EQ(literals[i],
+                                       t->literals + t->tokens[i].offset,
+                                       t->tokens[i].len);
+                }
+        }
+
+        PASS();
+}
+
+TEST test_format_render(void)
+{
+        notification *n = notification_create();
+        n->appname = "App";
+        n->summary = "Summary";
+        n->body = "Body";
+        n->icon = "/path/to/icon.png";
+        n->markup = MARKUP_NO;
+
+        char *msg = format_render(format_compile("%a: %s %b %I %p%n %x  \\n"), n);
+        ASSERT_STR_EQ("App: Summary Body icon.png  %x", msg);
+        g_free(msg);
+
+        n->progress = 42;
+        msg = format_render(format_compile("%p %n"), n);
+        ASSERT_STR_EQ("[ 42%] 42", msg);
+        g_free(msg);
+
+        g_free(n);
+        PASS();
+}
+
+TEST test_format_render_truncate(void)
+{
+        notification *n = notification_create();
+        char *body = g_strnfill(DUNST_NOTIF_MAX_CHARS + 1, 'x');
+        n->body = body;
+        n->markup = MARKUP_NO;
+
+        body[DUNST_NOTIF_MAX_CHARS] = '\0';
+        char *msg = format_render(format_compile("%b"), n);
+        ASSERT_EQ(DUNST_NOTIF_MAX_CHARS, strlen(msg));
+        g_free(msg);
+
+        body[DUNST_NOTIF_MAX_CHARS] = 'x';
+        msg = format_render(format_compile("%b"), n);
+        ASSERT_EQ(DUNST_NOTIF_MAX_CHARS - 1, strlen(msg));
+        g_free(msg);
+
+        g_free(body);
+        g_free(n);
+        PASS();
+}
+
+SUITE(suite_format)
+{
+        RUN_TEST(test_format_compile);
+        RUN_TEST(test_format_render);
+        RUN_TEST(test_format_render_truncate);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,69 @@
+#include "greatest.h"
+#include "src/globset.h"
+
+#include <fnmatch.h>
+#include <glib.h>
+
+static const char *patterns[] = {
+        "", "*", "**", "disk", "disk*", "*full", "*disk*full*", "disk*full",
+        "*a*a*", "a*a", "*ab*ab*", "ab*b", "*k f*", "*", "*sk*sk*", "d*",
+};
+
+static const char *texts[] = {
+        "", "disk", "disk full", "the disk is full", "disk full!", "aa", "a",
+        "aba", "abab", "ab", "abb", "diskdisk", "disk sk", NULL,
+};
+
+TEST test_globset_match_fnmatch(void)
+{
+        globset *gs = globset_new();
+
+        for (int i = 0; i < G_N_ELEMENTS(patterns); i++)
+                ASSERT(globset_add(gs, patterns[i], i));
+        globset_build(gs);
+
+        ASSERT_EQ(G_N_ELEMENTS(patterns), globset_size(gs));
+
+        for (int j = 0; j < G_N_ELEMENTS(texts); j++) {
+                guint32 bits[GLOBSET_WORDS(G_N_ELEMENTS(patterns))] = { 0 };
+                const char *text = texts[j] ? texts[j] : "";
+
+                globset_match(gs, texts[j], bits);
+
+                for (int i = 0; i < G_N_ELEMENTS(patterns); i++) {
+                        bool expected = fnmatch(patterns[i], text, 0) == 0;
+                        ASSERT_EQm(patterns[i], expected, GLOBSET_TEST(bits, i));
+                }
+        }
+
+        globset_free(gs);
+        PASS();
+}
+
+TEST test_globset_unsupported(void)
+{
+        globset *gs = globset_new();
+
+        ASSERT_FALSE(globset_add(gs, "d?sk", 0));
+        ASSERT_FALSE(globset_add(gs, "[dD]isk", 1));
+        ASSERT_FALSE(globset_add(gs, "\\*disk", 2));
+        ASSERT(globset_add(gs, "*disk*", 40));
+        globset_build(gs);
+
+        ASSERT_EQ(1, globset_size(gs));
+
+        guint32 bits[GLOBSET_WORDS(41)] = { 0 };
+        globset_match(gs, "a disk", bits);
+        ASSERT(GLOBSET_TEST(bits, 40));
+        ASSERT_FALSE(GLOBSET_TEST(bits, 0));
+
+        globset_free(gs);
+        PASS();
+}
+
+SUITE(suite_globset)
+{
+        RUN_TEST(test_globset_match_fnmatch);
+        RUN_TEST(test_globset_unsupported);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
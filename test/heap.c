@@ -0,0 +1,144 @@
+#include "greatest.h"
+#include "src/heap.h"
+
+#include <glib.h>
+
+static gint cmp_int(gconstpointer a, gconstpointer b)
+{
+        return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+struct tracked {
+        int key;
+        guint index;
+};
+
+static gint cmp_tracked(gconstpointer a, gconstpointer b)
+{
+        return ((const struct tracked *)a)->key - ((const struct tracked *)b)->key;
+}
+
+static void set_index_tracked(gpointer item, guint index)
+{
+        ((struct tracked *)item)->index = index;
+}
+
+TEST test_heap_push_pop(void)
+{
+        int values[] = { 5, 3, 9, 1, 7, 3, 8, 2 };
+        int sorted[] = { 1, 2, 3, 3, 5, 7, 8, 9 };
+        heap *h = heap_new(cmp_int, NULL);
+
+        ASSERT_EQ(NULL, heap_peek(h));
+        ASSERT_EQ(NULL, heap_pop(h));
+
+        for (int i = 0; i < G_N_ELEMENTS(values); i++)
+                heap_push(h, GINT_TO_POINTER(values[i]));
+
+        ASSERT_EQ(G_N_ELEMENTS(values), heap_length(h));
+        ASSERT_EQ(1, GPOINTER_TO_INT(heap_peek(h)));
+
+        for (int i = 0; i < G_N_ELEMENTS(sorted); i++)
+                ASSERT_EQ(sorted[i], GPOINTER_TO_INT(heap_pop(h)));
+
+        ASSERT_EQ(0, heap_length(h));
+
+        heap_free(h);
+        PASS();
+}
+
+TEST test_heap_remove_update(void)
+{
+        struct tracked items[6] = { {4}, {8}, {1}, {6}, {3}, {7} };
+        heap *h = heap_new(cmp_tracked, set_index_tracked);
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                heap_push(h, &items[i]);
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                ASSERT_EQ(&items[i], heap_get(h, items[i].index));
+
+        /* remove 6 */
+        ASSERT_EQ(&items[3], heap_remove(h, items[3].index));
+
+        /* 8 -> 0, 1 -> 5 */
+        items[1].key = 0;
+        heap_update(h, items[1].index);
+        items[2].key = 5;
+        heap_update(h, items[2].index);
+
+        ASSERT_EQ(&items[1], heap_pop(h));
+        ASSERT_EQ(&items[4], heap_pop(h));
+        ASSERT_EQ(&items[0], heap_pop(h));
+        ASSERT_EQ(&items[2], heap_pop(h));
+        ASSERT_EQ(&items[5], heap_pop(h));
+        ASSERT_EQ(NULL, heap_pop(h));
+
+        heap_free(h);
+        PASS();
+}
+
+TEST test_heap_rebuild(void)
+{
+        struct tracked items[5] = { {1}, {2}, {3}, {4}, {5} };
+        heap *h = heap_new(cmp_tracked, set_index_tracked);
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                heap_push(h, &items[i]);
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                items[i].key = 10 - items[i].key;
+        heap_rebuild(h);
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                ASSERT_EQ(&items[i], heap_get(h, items[i].index));
+
+        for (int i = G_N_ELEMENTS(items); i > 0; i--)
+                ASSERT_EQ(&items[i - 1], heap_pop(h));
+
+        heap_free(h);
+        PASS();
+}
+
+TEST test_heap_merge(void)
+{
+        struct tracked items[12];
+        heap *h = heap_new(cmp_tracked, set_index_tracked);
+        GPtrArray *few = g_ptr_array_new();
+        GPtrArray *many = g_ptr_array_new();
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++) {
+                items[i].key = (i * 7) % G_N_ELEMENTS(items);
+                if (i == 0)
+                        g_ptr_array_add(few, &items[i]);
+                else if (i < 11)
+                        g_ptr_array_add(many, &items[i]);
+                else
+                        heap_push(h, &items[i]);
+        }
+
+        heap_merge(h, many);
+        heap_merge(h, few);
+        ASSERT_EQ(G_N_ELEMENTS(items), heap_length(h));
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                ASSERT_EQ(&items[i], heap_get(h, items[i].index));
+
+        for (int i = 0; i < G_N_ELEMENTS(items); i++)
+                ASSERT_EQ(i, ((struct tracked *)heap_pop(h))->key);
+
+        g_ptr_array_free(few, TRUE);
+        g_ptr_array_free(many, TRUE);
+        heap_free(h);
+        PASS();
+}
+
+SUITE(suite_heap)
+{
+        RUN_TEST(test_heap_push_pop);
+        RUN_TEST(test_heap_remove_update);
+        RUN_TEST(test_heap_rebuild);
+        RUN_TEST(test_heap_merge);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,93 @@
+#include "helpers.h"
+
+#include <glib.h>
+#include <sys/socket.h>
+
+extern GDBusConnection *dbus_conn;
+
+static GDBusConnection *peer = NULL;
+
+static void test_dbus_peer_ready(GObject *source, GAsyncResult *res, gpointer data)
+{
+        bool *done = data;
+
+        peer = g_dbus_connection_new_finish(res, NULL);
+        *done = true;
+}
+
+/* see helpers.h */
+GDBusConnection *test_dbus_connect(void)
+{
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+                return NULL;
+
+        GSocket *sockets[2] = {
+                g_socket_new_from_fd(fds[0], NULL),
+                g_socket_new_from_fd(fds[1], NULL),
+        };
+        GSocketConnection *streams[2] = {
+                g_socket_connection_factory_create_connection(sockets[0]),
+                g_socket_connection_factory_create_connection(sockets[1]),
+        };
+
+        /* The handshake of either side blocks until the other one answers,
+         * so the peer authenticates in the background */
+        bool done = false;
+        char *guid = g_dbus_generate_guid();
+        g_dbus_connection_new(G_IO_STREAM(streams[0]),
+                              guid,
+                              G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                              NULL, NULL,
+                              test_dbus_peer_ready, &done);
+        dbus_conn = g_dbus_connection_new_sync(G_IO_STREAM(streams[1]),
+                                               NULL,
+                                               G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                               NULL, NULL, NULL);
+        while (!done)
+                g_main_context_iteration(NULL, TRUE);
+
+        g_free(guid);
+        for (int i = 0; i < 2; i++) {
+                g_object_unref(streams[i]);
+                g_object_unref(sockets[i]);
+        }
+
+        if (!dbus_conn || !peer) {
+                test_dbus_disconnect();
+                return NULL;
+        }
+
+        return peer;
+}
+
+/* see helpers.h */
+void test_dbus_disconnect(void)
+{
+        GDBusConnection *ends[] = { dbus_conn, peer };
+
+        for (int i = 0; i < G_N_ELEMENTS(ends); i++) {
+                if (!ends[i])
+                        continue;
+                g_dbus_connection_close_sync(ends[i], NULL, NULL);
+                g_object_unref(ends[i]);
+        }
+
+        dbus_conn = NULL;
+        peer = NULL;
+}
+
+/* see helpers.h */
+notification *test_notification(const char *summary, gint64 timeout)
+{
+        notification *n = notification_create();
+
+        n->summary = g_strdup(summary);
+        n->body = g_strdup("");
+        n->format = "%s";
+        n->timeout = timeout;
+        notification_init(n);
+
+        return n;
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
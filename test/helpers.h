@@ -0,0 +1,31 @@
+#ifndef DUNST_TEST_HELPERS_H
+#define DUNST_TEST_HELPERS_H
+
+#include <gio/gio.h>
+
+#include "src/notification.h"
+
+/**
+ * Connect the global DBus connection to a peer over a socketpair, so that
+ * signals can be sent without a bus.
+ *
+ * @return (transfer none) the peer, which receives the signals
+ * @return NULL, if the connection failed
+ */
+GDBusConnection *test_dbus_connect(void);
+
+/**
+ * Close both ends of the connection made by test_dbus_connect()
+ */
+void test_dbus_disconnect(void);
+
+/**
+ * Create an initialized notification, ready to get inserted into the queues
+ *
+ * @param summary The summary, which makes up the message
+ * @param timeout The timeout in microseconds, 0 to never time out
+ */
+notification *test_notification(const char *summary, gint64 timeout);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,261 @@
+#include "greatest.h"
+#include "src/icon.h"
+#include "src/settings.h"
+
+#include <glib.h>
+#include <unistd.h>
+
+static RawImage *test_raw_image_channels(const guchar *pixels, int width, int height, int channels)
+{
+        RawImage *raw = g_malloc(sizeof(RawImage));
+
+        raw->width = width;
+        raw->height = height;
+        raw->rowstride = width * channels;
+        raw->has_alpha = channels == 4;
+        raw->bits_per_sample = 8;
+        raw->n_channels = channels;
+        raw->bytes = g_bytes_new(pixels, width * height * channels);
+        raw->data = g_bytes_get_data(raw->bytes, NULL);
+        raw->argb32 = false;
+
+        return raw;
+}
+
+static RawImage *test_raw_image(const guchar *pixels, int width, int height)
+{
+        return test_raw_image_channels(pixels, width, height, 4);
+}
+
+TEST test_icon_ingest_raw_image(void)
+{
+        const guchar pixels[] = {
+                0xff, 0x00, 0x00, 0x80,
+                0x00, 0xff, 0x00, 0xff,
+        };
+
+        RawImage *image = icon_ingest_raw_image(test_raw_image(pixels, 2, 1), 0);
+
+        ASSERT(image);
+        ASSERT(image->argb32);
+        ASSERT_EQ(2, image->width);
+        ASSERT_EQ(1, image->height);
+
+        const guint32 *argb = (const guint32 *) image->data;
+        ASSERT_EQ(0x80800000, argb[0]);
+        ASSERT_EQ(0xff00ff00, argb[1]);
+
+        rawimage_free(image);
+        PASS();
+}
+
+TEST test_icon_ingest_raw_image_rows(void)
+{
+        /* more pixels than fit into a single vector */
+        const guchar pixels[] = {
+                0x10, 0x20, 0x30, 0x00,
+                0x10, 0x20, 0x30, 0xff,
+                0xff, 0xff, 0xff, 0x80,
+                0x40, 0x80, 0xc0, 0x40,
+                0xff, 0x00, 0x00, 0x80,
+        };
+        const guint32 expected[] = {
+                0x00000000, 0xff102030, 0x80808080, 0x40102030, 0x80800000,
+        };
+
+        RawImage *image = icon_ingest_raw_image(test_raw_image(pixels, 5, 1), 0);
+
+        ASSERT(image);
+        const guint32 *argb = (const guint32 *) image->data;
+        for (int i = 0; i < G_N_ELEMENTS(expected); i++)
+                ASSERT_EQ_FMT(expected[i], argb[i], "%08x");
+
+        rawimage_free(image);
+        PASS();
+}
+
+TEST test_icon_ingest_raw_image_rgb(void)
+{
+        const guchar pixels[] = {
+                0x10, 0x20, 0x30,
+                0xff, 0x00, 0x80,
+        };
+
+        RawImage *image = icon_ingest_raw_image(test_raw_image_channels(pixels, 2, 1, 3), 0);
+
+        ASSERT(image);
+        ASSERT(image->has_alpha);
+        const guint32 *argb = (const guint32 *) image->data;
+        ASSERT_EQ_FMT(0xff102030, argb[0], "%08x");
+        ASSERT_EQ_FMT(0xffff0080, argb[1], "%08x");
+
+        rawimage_free(image);
+        PASS();
+}
+
+TEST test_icon_ingest_raw_image_scales(void)
+{
+        guchar pixels[8 * 4 * 4];
+        memset(pixels, 0xff, sizeof(pixels));
+
+        RawImage *image = icon_ingest_raw_image(test_raw_image(pixels, 8, 4), 4);
+
+        ASSERT(image);
+        ASSERT_EQ(4, image->width);
+        ASSERT_EQ(2, image->height);
+        ASSERT_EQ(0xffffffff, ((const guint32 *) image->data)[0]);
+
+        rawimage_free(image);
+        PASS();
+}
+
+TEST test_icon_cache(void)
+{
+        char *path = g_build_filename(g_get_tmp_dir(), "dunst-test-icon.png", NULL);
+        GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, 4, 4);
+        gdk_pixbuf_fill(pixbuf, 0xff0000ff);
+        ASSERT(gdk_pixbuf_save(pixbuf, path, "png", NULL, NULL));
+        g_object_unref(pixbuf);
+
+        int entries_tmp = settings.icon_cache_entries;
+        int size_tmp = settings.icon_cache_size;
+        char *icon_path_tmp = settings.icon_path;
+        settings.icon_cache_entries = 1;
+        settings.icon_cache_size = 1;
+
+        cairo_surface_t *first = icon_get_for_path(path, 0);
+        cairo_surface_t *again = icon_get_for_path(path, 0);
+        cairo_surface_t *smaller = icon_get_for_path(path, 2);
+        cairo_surface_t *evicted = icon_get_for_path(path, 0);
+
+        settings.icon_path = "/nonexistent";
+        cairo_surface_t *reloaded = icon_get_for_path(path, 0);
+
+        ASSERT(first);
+        ASSERT_EQ(first, again);
+        ASSERT_EQ(2, cairo_image_surface_get_width(smaller));
+        ASSERT(evicted != first);
+        ASSERT(reloaded != evicted);
+
+        /* a rewritten file replaces the cached icon */
+        ASSERT(icon_is_current(path, 0, reloaded));
+        pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, 8, 8);
+        gdk_pixbuf_fill(pixbuf, 0x00ff00ff);
+        ASSERT(gdk_pixbuf_save(pixbuf, path, "png", NULL, NULL));
+        g_object_unref(pixbuf);
+
+        ASSERT_FALSE(icon_is_current(path, 0, reloaded));
+        cairo_surface_t *rewritten = icon_get_for_path(path, 0);
+        ASSERT(rewritten);
+        ASSERT(icon_is_current(path, 0, rewritten));
+        ASSERT(rewritten != reloaded);
+        ASSERT_EQ(8, cairo_image_surface_get_width(rewritten));
+
+        /* a missing file isn't remembered */
+        unlink(path);
+        ASSERT_EQ(NULL, icon_get_for_path(path, 0));
+
+        pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, 4, 4);
+        gdk_pixbuf_fill(pixbuf, 0xff0000ff);
+        ASSERT(gdk_pixbuf_save(pixbuf, path, "png", NULL, NULL));
+        g_object_unref(pixbuf);
+
+        cairo_surface_t *restored = icon_get_for_path(path, 0);
+        ASSERT(restored);
+        ASSERT_EQ(4, cairo_image_surface_get_width(restored));
+
+        cairo_surface_destroy(first);
+        cairo_surface_destroy(again);
+        cairo_surface_destroy(smaller);
+        cairo_surface_destroy(evicted);
+        cairo_surface_destroy(reloaded);
+        cairo_surface_destroy(rewritten);
+        cairo_surface_destroy(restored);
+
+        icon_cache_clear();
+        settings.icon_cache_entries = entries_tmp;
+        settings.icon_cache_size = size_tmp;
+        settings.icon_path = icon_path_tmp;
+        unlink(path);
+        g_free(path);
+        PASS();
+}
+
+static void test_save_icon(const char *dir, const char *file, int size)
+{
+        char *path = g_build_filename(dir, file, NULL);
+        GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, size, size);
+        gdk_pixbuf_fill(pixbuf, 0xff0000ff);
+        gdk_pixbuf_save(pixbuf, path, "png", NULL, NULL);
+        g_object_unref(pixbuf);
+        g_free(path);
+}
+
+TEST test_icon_path_lookup(void)
+{
+        char *first = g_build_filename(g_get_tmp_dir(), "dunst-test-icons-1", NULL);
+        char *second = g_build_filename(g_get_tmp_dir(), "dunst-test-icons-2", NULL);
+        g_mkdir_with_parents(first, 0700);
+        g_mkdir_with_parents(second, 0700);
+
+        test_save_icon(first, "both.png", 1);
+        test_save_icon(second, "both.png", 2);
+        test_save_icon(second, "second.png", 3);
+        test_save_icon(second, "broken.png", 4);
+
+        char *broken = g_build_filename(first, "broken.png", NULL);
+        ASSERT(g_file_set_contents(broken, "no png", -1, NULL));
+        g_free(broken);
+
+        char *icon_path_tmp = settings.icon_path;
+        settings.icon_path = g_strconcat(first, ":", second, NULL);
+
+        cairo_surface_t *both = icon_get_for_path("both", 0);
+        cairo_surface_t *in_second = icon_get_for_path("second", 0);
+        cairo_surface_t *missing = icon_get_for_path("missing", 0);
+        cairo_surface_t *fallback = icon_get_for_path("broken", 0);
+
+        ASSERT(both);
+        ASSERT_EQ(1, cairo_image_surface_get_width(both));
+        ASSERT(in_second);
+        ASSERT_EQ(3, cairo_image_surface_get_width(in_second));
+        ASSERT_FALSE(missing);
+        ASSERT(fallback);
+        ASSERT_EQ(4, cairo_image_surface_get_width(fallback));
+
+        cairo_surface_destroy(both);
+        cairo_surface_destroy(in_second);
+        cairo_surface_destroy(fallback);
+        icon_teardown();
+
+        g_free(settings.icon_path);
+        settings.icon_path = icon_path_tmp;
+
+        char *files[] = {
+                g_build_filename(first, "both.png", NULL),
+                g_build_filename(second, "both.png", NULL),
+                g_build_filename(second, "second.png", NULL),
+                g_build_filename(first, "broken.png", NULL),
+                g_build_filename(second, "broken.png", NULL),
+        };
+        for (int i = 0; i < G_N_ELEMENTS(files); i++) {
+                unlink(files[i]);
+                g_free(files[i]);
+        }
+        rmdir(first);
+        rmdir(second);
+        g_free(first);
+        g_free(second);
+        PASS();
+}
+
+SUITE(suite_icon)
+{
+        RUN_TEST(test_icon_ingest_raw_image);
+        RUN_TEST(test_icon_ingest_raw_image_rows);
+        RUN_TEST(test_icon_ingest_raw_image_rgb);
+        RUN_TEST(test_icon_ingest_raw_image_scales);
+        RUN_TEST(test_icon_cache);
+        RUN_TEST(test_icon_path_lookup);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,50 @@
+#include "greatest.h"
+#include "src/intern.h"
+
+#include <glib.h>
+
+TEST test_intern_equal_strings(void)
+{
+        char *buf = g_strdup("appname");
+        char *a = intern("appname");
+        char *b = intern(buf);
+
+        ASSERT_EQ(a, b);
+        ASSERT_STR_EQ("appname", a);
+        ASSERT(intern_owns(a));
+        ASSERT_FALSE(intern_owns(buf));
+        ASSERT_EQ(NULL, intern(NULL));
+
+        intern_release(a);
+        ASSERT(intern_owns(b));
+        intern_release(b);
+
+        g_free(buf);
+        PASS();
+}
+
+TEST test_intern_take(void)
+{
+        char *a = intern_take(g_strdup("category"));
+        char *b = intern_take(g_strdup("category"));
+
+        ASSERT_EQ(a, b);
+
+        /* interned strings get passed through without another reference */
+        ASSERT_EQ(a, intern_take(a));
+        ASSERT_EQ(NULL, intern_take(NULL));
+
+        intern_release(a);
+        ASSERT(intern_owns(b));
+        intern_release(b);
+
+        PASS();
+}
+
+SUITE(suite_intern)
+{
+        RUN_TEST(test_intern_equal_strings);
+        RUN_TEST(test_intern_take);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -70,6 +70,73 @@ TEST test_notification_is_duplicate(void *notifications)
         PASS();
 }
 
+TEST test_notification_fingerprint(void *notifications)
+{
+        notification **n = (notification**)notifications;
+        notification *a = n[0];
+        notification *b = n[1];
+
+        ASSERT_EQ(notification_fingerprint(a), notification_fingerprint(b));
+
+        char *tmp = b->summary;
+        b->summary = "Something different";
+        ASSERT_FALSE(notification_fingerprint(a) == notification_fingerprint(b));
+        b->summary = tmp;
+
+        enum urgency urgency_tmp = b->urgency;
+        b->urgency = URG_CRIT;
+        ASSERT_FALSE(notification_fingerprint(a) == notification_fingerprint(b));
+        b->urgency = urgency_tmp;
+
+        PASS();
+}
+
+TEST test_notification_update_text_to_render(void)
+{
+        notification *n = notification_create();
+        n->msg = g_strdup("Message");
+
+        notification_update_text_to_render(n);
+        ASSERT_STR_EQ("Message", n->text_to_render);
+
+        /* unchanged parts keep the rendered text */
+        char *ttr = n->text_to_render;
+        notification_update_text_to_render(n);
+        ASSERT_EQ(ttr, n->text_to_render);
+
+        n->dup_count = 2;
+        notification_update_text_to_render(n);
+        ASSERT_STR_EQ("(2) Message", n->text_to_render);
+
+        notification_free(n);
+        PASS();
+}
+
+TEST test_notification_get_urls(void)
+{
+        notification *n = notification_create();
+        n->summary = g_strdup("Visit https://dunst-project.org");
+        n->body = g_strdup("for more");
+        notification_init(n);
+
+        ASSERT(n->urls_maybe);
+        ASSERT_FALSE(n->urls_extracted);
+        ASSERT_STR_EQ("https://dunst-project.org", notification_get_urls(n));
+        ASSERT(n->urls_extracted);
+        notification_free(n);
+
+        n = notification_create();
+        n->summary = g_strdup("No links");
+        n->body = g_strdup("in here");
+        notification_init(n);
+
+        ASSERT_FALSE(n->urls_maybe);
+        ASSERT_EQ(NULL, notification_get_urls(n));
+        notification_free(n);
+
+        PASS();
+}
+
 TEST test_notification_replace_single_field(void)
 {
         char *str = g_malloc(128 * sizeof(char));
@@ -116,10 +183,13 @@ SUITE(suite_notification)
         notification *n[2] = {a, b};
 
         RUN_TEST1(test_notification_is_duplicate, (void*) n);
+        RUN_TEST1(test_notification_fingerprint, (void*) n);
         g_free(a);
         g_free(b);
 
         RUN_TEST(test_notification_replace_single_field);
+        RUN_TEST(test_notification_update_text_to_render);
+        RUN_TEST(test_notification_get_urls);
 }
 
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,312 @@
+#include "greatest.h"
+#include "helpers.h"
+#include "src/queues.h"
+#include "src/settings.h"
+
+#include <glib.h>
+
+extern int next_notification_id;
+
+static void test_queues_setup(void *data)
+{
+        test_dbus_connect();
+        queues_init();
+}
+
+static void test_queues_teardown(void *data)
+{
+        teardown_queues();
+        test_dbus_disconnect();
+}
+
+static int test_insert(const char *summary, int id, bool replaces)
+{
+        notification *n = test_notification(summary, 0);
+        n->id = id;
+
+        return queues_notification_insert(n, replaces);
+}
+
+static int test_insert_timeout(const char *summary, gint64 timeout, bool transient)
+{
+        notification *n = test_notification(summary, timeout);
+        n->id = queues_reserve_id();
+        n->transient = transient;
+
+        return queues_notification_insert(n, false);
+}
+
+static const notification *test_displayed_head(void)
+{
+        const GList *head = queues_get_displayed();
+        return head ? head->data : NULL;
+}
+
+TEST test_queues_close_replace_id(void)
+{
+        int a = test_insert("A", queues_reserve_id(), false);
+        int b = test_insert("B", queues_reserve_id(), false);
+        queues_update(false);
+        int c = test_insert("C", queues_reserve_id(), false);
+        ASSERT_EQ(2, queues_length_displayed());
+        ASSERT_EQ(1, queues_length_waiting());
+
+        /* a displayed and a waiting notification keep their place */
+        ASSERT_EQ(a, test_insert("A2", a, true));
+        ASSERT_EQ(c, test_insert("C2", c, true));
+        ASSERT_EQ(2, queues_length_displayed());
+        ASSERT_EQ(1, queues_length_waiting());
+
+        queues_notification_close_id(a, REASON_USER);
+        ASSERT_STR_EQ("A2", queues_get_history(0)->summary);
+        queues_notification_close_id(c, REASON_USER);
+        ASSERT_STR_EQ("C2", queues_get_history(0)->summary);
+        ASSERT_EQ(1, queues_length_displayed());
+        ASSERT_EQ(0, queues_length_waiting());
+
+        /* closed ids aren't known anymore */
+        queues_notification_close_id(a, REASON_USER);
+        ASSERT_EQ(2, queues_length_history());
+
+        queues_notification_close_id(b, REASON_USER);
+        ASSERT_STR_EQ("B", queues_get_history(0)->summary);
+        ASSERT_EQ(0, queues_length_displayed());
+        PASS();
+}
+
+TEST test_queues_stack_duplicates(void)
+{
+        bool stack_tmp = settings.stack_duplicates;
+        settings.stack_duplicates = true;
+
+        test_insert("Dup", queues_reserve_id(), false);
+        queues_update(false);
+        int b = test_insert("Dup", queues_reserve_id(), false);
+        ASSERT_EQ(1, queues_length_displayed());
+        ASSERT_EQ(0, queues_length_waiting());
+        ASSERT_EQ(b, test_displayed_head()->id);
+        ASSERT_EQ(1, test_displayed_head()->dup_count);
+
+        /* the closed one left its fingerprint bucket */
+        queues_notification_close_id(b, REASON_USER);
+        test_insert("Dup", queues_reserve_id(), false);
+        test_insert("Other", queues_reserve_id(), false);
+        ASSERT_EQ(2, queues_length_waiting());
+
+        test_insert("Dup", queues_reserve_id(), false);
+        ASSERT_EQ(2, queues_length_waiting());
+
+        settings.stack_duplicates = stack_tmp;
+        PASS();
+}
+
+TEST test_queues_timeouts_pause(void)
+{
+        const gint64 unit = 50 * 1000;
+        int slow = test_insert_timeout("Slow", 3 * unit, false);
+        int fast = test_insert_timeout("Fast", unit, false);
+        queues_update(false);
+        ASSERT_EQ(2, queues_length_displayed());
+
+        /* paused notifications wait and don't time out */
+        queues_pause_on();
+        queues_update(false);
+        ASSERT_EQ(0, queues_length_displayed());
+        g_usleep(4 * unit);
+        queues_check_timeouts(false, false);
+        ASSERT_EQ(2, queues_length_waiting());
+
+        /* shown again, their timeouts start over */
+        queues_pause_off();
+        queues_update(false);
+        ASSERT_EQ(2, queues_length_displayed());
+        gint64 sleep = queues_get_next_datachange(g_get_monotonic_time());
+        ASSERT(sleep > 0);
+        ASSERT(sleep <= unit);
+
+        g_usleep(2 * unit);
+        queues_check_timeouts(false, false);
+        ASSERT_EQ(1, queues_length_displayed());
+        ASSERT_EQ(fast, queues_get_history(0)->id);
+
+        g_usleep(2 * unit);
+        queues_check_timeouts(false, false);
+        ASSERT_EQ(0, queues_length_displayed());
+        ASSERT_EQ(slow, queues_get_history(0)->id);
+        PASS();
+}
+
+TEST test_queues_transient_while_idle(void)
+{
+        const gint64 timeout = 20 * 1000;
+        int transient = test_insert_timeout("Transient", timeout, true);
+        test_insert_timeout("Persistent", timeout, false);
+        queues_update(false);
+        ASSERT_EQ(2, queues_length_displayed());
+
+        queues_check_timeouts(true, false);
+        ASSERT(queues_get_next_datachange(g_get_monotonic_time()) <= timeout);
+
+        g_usleep(2 * timeout);
+        queues_check_timeouts(true, false);
+        ASSERT_EQ(1, queues_length_displayed());
+        ASSERT_EQ(transient, queues_get_history(0)->id);
+        ASSERT_STR_EQ("Persistent", test_displayed_head()->summary);
+        PASS();
+}
+
+TEST test_queues_history(void)
+{
+        const char *summaries[] = { "0", "1", "2", "3", "4", "5" };
+        int length_tmp = settings.history_length;
+        int sticky_tmp = settings.sticky_history;
+        settings.history_length = 3;
+        settings.sticky_history = true;
+
+        for (int i = 0; i < 5; i++) {
+                int id = test_insert(summaries[i], queues_reserve_id(), false);
+                queues_notification_close_id(id, REASON_USER);
+        }
+
+        ASSERT_EQ(3, queues_length_history());
+        ASSERT_STR_EQ("4", queues_get_history(0)->summary);
+        ASSERT_STR_EQ("3", queues_get_history(1)->summary);
+        ASSERT_STR_EQ("2", queues_get_history(2)->summary);
+        ASSERT_EQ(NULL, queues_get_history(3));
+
+        /* the latest one comes back first and sticks */
+        queues_history_pop();
+        ASSERT_EQ(2, queues_length_history());
+        ASSERT_EQ(1, queues_length_waiting());
+        queues_update(false);
+        ASSERT_STR_EQ("4", test_displayed_head()->summary);
+        ASSERT_EQ(0, test_displayed_head()->timeout);
+
+        queues_notification_close_id(test_displayed_head()->id, REASON_USER);
+        ASSERT_EQ(3, queues_length_history());
+        ASSERT_STR_EQ("4", queues_get_history(0)->summary);
+
+        /* the oldest one makes room */
+        int id = test_insert(summaries[5], queues_reserve_id(), false);
+        queues_notification_close_id(id, REASON_USER);
+        ASSERT_EQ(3, queues_length_history());
+        ASSERT_STR_EQ("5", queues_get_history(0)->summary);
+        ASSERT_STR_EQ("3", queues_get_history(2)->summary);
+
+        settings.history_length = length_tmp;
+        settings.sticky_history = sticky_tmp;
+        PASS();
+}
+
+TEST test_queues_replace_unknown_id(void)
+{
+        int requested = next_notification_id + 1;
+        ASSERT_EQ(requested, test_insert("Requested", requested, true));
+
+        int reserved = queues_reserve_id();
+        ASSERT(reserved != requested);
+        ASSERT_EQ(reserved, test_insert("Reserved", reserved, false));
+        ASSERT_EQ(2, queues_length_waiting());
+
+        queues_notification_close_id(requested, REASON_USER);
+        ASSERT_STR_EQ("Requested", queues_get_history(0)->summary);
+        queues_notification_close_id(reserved, REASON_USER);
+        ASSERT_STR_EQ("Reserved", queues_get_history(0)->summary);
+        ASSERT_EQ(0, queues_length_waiting());
+        PASS();
+}
+
+TEST test_queues_replace_history_id(void)
+{
+        int id = test_insert("Closed", queues_reserve_id(), false);
+        queues_notification_close_id(id, REASON_USER);
+
+        /* the closed one is in history, so this is a new notification */
+        ASSERT_EQ(id, test_insert("Replacement", id, true));
+        ASSERT_EQ(1, queues_length_history());
+
+        queues_history_pop();
+        ASSERT_EQ(2, queues_length_waiting());
+
+        queues_notification_close_id(id, REASON_USER);
+        ASSERT_STR_EQ("Replacement", queues_get_history(0)->summary);
+        ASSERT_EQ(1, queues_length_waiting());
+
+        queues_history_push_all();
+        ASSERT_STR_EQ("Closed", queues_get_history(0)->summary);
+        ASSERT(queues_get_history(0)->id != id);
+        PASS();
+}
+
+TEST test_queues_reserve_id_skips_history(void)
+{
+        int id = test_insert("Closed", queues_reserve_id(), false);
+        queues_notification_close_id(id, REASON_USER);
+
+        /* as if the ids wrapped around */
+        next_notification_id = id - 1;
+        int reserved = queues_reserve_id();
+        ASSERT(reserved != id);
+        ASSERT_EQ(reserved, test_insert("Reserved", reserved, false));
+
+        queues_history_pop();
+        ASSERT_EQ(2, queues_length_waiting());
+
+        queues_notification_close_id(id, REASON_USER);
+        ASSERT_STR_EQ("Closed", queues_get_history(0)->summary);
+        queues_notification_close_id(reserved, REASON_USER);
+        ASSERT_STR_EQ("Reserved", queues_get_history(0)->summary);
+        ASSERT_EQ(0, queues_length_waiting());
+        PASS();
+}
+
+TEST test_queues_timeout_after_idle(void)
+{
+        const gint64 timeout = 20 * 1000;
+        notification *n = test_notification("Idle", timeout);
+        n->id = queues_reserve_id();
+        queues_notification_insert(n, false);
+        queues_update(false);
+        ASSERT_EQ(1, queues_length_displayed());
+
+        /* no timeout while idle, but keep polling for the user */
+        queues_check_timeouts(true, false);
+        gint64 sleep = queues_get_next_datachange(g_get_monotonic_time());
+        ASSERT(sleep > 0);
+        ASSERT(sleep <= timeout);
+
+        g_usleep(2 * timeout);
+        queues_check_timeouts(true, false);
+        ASSERT_EQ(1, queues_length_displayed());
+
+        /* the user returns and the timeout starts over */
+        queues_check_timeouts(false, false);
+        ASSERT_EQ(1, queues_length_displayed());
+        ASSERT(queues_get_next_datachange(g_get_monotonic_time()) > 0);
+
+        g_usleep(2 * timeout);
+        queues_check_timeouts(false, false);
+        ASSERT_EQ(0, queues_length_displayed());
+        ASSERT_EQ(1, queues_length_history());
+        PASS();
+}
+
+SUITE(suite_queues)
+{
+        SET_SETUP(test_queues_setup, NULL);
+        SET_TEARDOWN(test_queues_teardown, NULL);
+
+        RUN_TEST(test_queues_close_replace_id);
+        RUN_TEST(test_queues_stack_duplicates);
+        RUN_TEST(test_queues_timeouts_pause);
+        RUN_TEST(test_queues_transient_while_idle);
+        RUN_TEST(test_queues_history);
+        RUN_TEST(test_queues_replace_unknown_id);
+        RUN_TEST(test_queues_replace_history_id);
+        RUN_TEST(test_queues_reserve_id_skips_history);
+        RUN_TEST(test_queues_timeout_after_idle);
+
+        SET_SETUP(NULL, NULL);
+        SET_TEARDOWN(NULL, NULL);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
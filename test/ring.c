@@ -0,0 +1,74 @@
+#include "greatest.h"
+#include "src/ring.h"
+
+#include <glib.h>
+
+TEST test_ring_push_pop_shift(void)
+{
+        ring *r = ring_new(4);
+
+        ASSERT_EQ(NULL, ring_pop(r));
+        ASSERT_EQ(NULL, ring_shift(r));
+
+        for (int i = 1; i <= 3; i++)
+                ring_push(r, GINT_TO_POINTER(i));
+
+        ASSERT_EQ(3, ring_length(r));
+        ASSERT_EQ(3, GPOINTER_TO_INT(ring_pop(r)));
+        ASSERT_EQ(1, GPOINTER_TO_INT(ring_shift(r)));
+        ASSERT_EQ(2, GPOINTER_TO_INT(ring_shift(r)));
+        ASSERT_EQ(0, ring_length(r));
+        ASSERT_EQ(NULL, ring_pop(r));
+
+        ring_free(r, NULL);
+        PASS();
+}
+
+TEST test_ring_wrap_and_grow(void)
+{
+        ring *r = ring_new(4);
+
+        /* move the head to the middle of the storage */
+        for (int i = 0; i < 3; i++)
+                ring_push(r, GINT_TO_POINTER(i));
+        for (int i = 0; i < 3; i++)
+                ring_shift(r);
+
+        /* wraps around, then grows beyond the preallocated capacity */
+        for (int i = 1; i <= 10; i++)
+                ring_push(r, GINT_TO_POINTER(i));
+
+        ASSERT_EQ(10, ring_length(r));
+        ASSERT(r->capacity >= 10);
+
+        for (int i = 0; i < 10; i++)
+                ASSERT_EQ(i + 1, GPOINTER_TO_INT(ring_get(r, i)));
+
+        ASSERT_EQ(10, GPOINTER_TO_INT(ring_pop(r)));
+        ASSERT_EQ(1, GPOINTER_TO_INT(ring_shift(r)));
+        ASSERT_EQ(2, GPOINTER_TO_INT(ring_get(r, 0)));
+        ASSERT_EQ(9, GPOINTER_TO_INT(ring_get(r, ring_length(r) - 1)));
+
+        ring_free(r, NULL);
+        PASS();
+}
+
+TEST test_ring_free_items(void)
+{
+        ring *r = ring_new(0);
+
+        for (int i = 0; i < 20; i++)
+                ring_push(r, g_strdup("item"));
+
+        ring_free(r, g_free);
+        PASS();
+}
+
+SUITE(suite_ring)
+{
+        RUN_TEST(test_ring_push_pop_shift);
+        RUN_TEST(test_ring_wrap_and_grow);
+        RUN_TEST(test_ring_free_items);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
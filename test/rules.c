@@ -0,0 +1,304 @@
+#include "greatest.h"
+#include "src/log.h"
+#include "src/rules.h"
+#include "src/settings.h"
+
+#include <glib.h>
+
+static notification *test_notification(const char *appname, const char *category,
+                                       const char *summary, const char *body)
+{
+        notification *n = g_malloc0(sizeof(notification));
+        n->appname = (char *) appname;
+        n->category = (char *) category;
+        n->summary = (char *) summary;
+        n->body = (char *) body;
+        n->icon = "";
+        n->urgency = URG_NORM;
+        n->timeout = -1;
+        return n;
+}
+
+/* Apply a single rule through the compiled index and report if it matched */
+static bool test_compiled_match(rule_t *r, notification *n)
+{
+        GSList *saved = rules;
+
+        r->timeout = 42;
+        n->timeout = -1;
+        rules = g_slist_append(NULL, r);
+        rules_compile();
+        rule_apply_all(n);
+
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        return n->timeout == 42;
+}
+
+TEST test_rules_compiled_matchers(void)
+{
+        const char *patterns[] = {
+                "*", "**", "Firefox", "Fire*", "*fox", "*ref*", "*re*ox",
+                "F?refox", "[Ff]irefox", "\\Firefox", "firefox", "", "*x*y*",
+        };
+        const char *values[] = { "Firefox", "firefox", "", "Fire", "xy" };
+
+        for (int i = 0; i < G_N_ELEMENTS(patterns); i++) {
+                for (int j = 0; j < G_N_ELEMENTS(values); j++) {
+                        rule_t r;
+                        rule_init(&r);
+                        r.summary = (char *) patterns[i];
+
+                        notification *n = test_notification("app", "cat", values[j], "");
+                        bool expected = rule_matches_notification(&r, n);
+                        bool compiled = test_compiled_match(&r, n);
+                        g_free(n);
+
+                        ASSERT_EQm(patterns[i], expected, compiled);
+                }
+        }
+
+        PASS();
+}
+
+TEST test_rules_apply_order(void)
+{
+        GSList *saved = rules;
+        rule_t r[4];
+
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        /* generic, appname bucket, category bucket and appname bucket again */
+        r[0].summary = "*";
+        r[0].timeout = 1;
+        r[1].appname = "app";
+        r[1].timeout = 2;
+        r[2].appname = "a*";
+        r[2].category = "cat";
+        r[2].timeout = 3;
+        r[3].appname = "app";
+        r[3].body = "nomatch";
+        r[3].timeout = 4;
+
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        notification *n = test_notification("app", "cat", "summary", "body");
+        rule_apply_all(n);
+        ASSERT_EQ(3, n->timeout);
+
+        /* the later appname rule overrides the category rule */
+        r[3].body = "b*";
+        rules_compile();
+        n->timeout = -1;
+        rule_apply_all(n);
+        ASSERT_EQ(4, n->timeout);
+
+        /* other applications only see the generic rule */
+        n->appname = "other";
+        n->timeout = -1;
+        rule_apply_all(n);
+        ASSERT_EQ(1, n->timeout);
+
+        g_free(n);
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        PASS();
+}
+
+TEST test_rules_memo(void)
+{
+        GSList *saved = rules;
+        rule_t r[3];
+
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        /* the content rule raises the urgency, which the last rule needs */
+        r[0].appname = "app";
+        r[0].timeout = 1;
+        r[1].body = "*urgent*";
+        r[1].urgency = URG_CRIT;
+        r[2].msg_urgency = URG_CRIT;
+        r[2].timeout = 2;
+
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        struct rule_memo_stats before = *rules_get_memo_stats();
+
+        notification *n = test_notification("app", "cat", "summary", "body");
+        rule_apply_all(n);
+        ASSERT_EQ(1, n->timeout);
+        ASSERT_EQ(before.misses + 1, rules_get_memo_stats()->misses);
+
+        notification *m = test_notification("app", "cat", "summary", "urgent body");
+        rule_apply_all(m);
+        ASSERT_EQ(2, m->timeout);
+        ASSERT_EQ(URG_CRIT, m->urgency);
+        ASSERT_EQ(before.hits + 1, rules_get_memo_stats()->hits);
+
+        n->timeout = -1;
+        rule_apply_all(n);
+        ASSERT_EQ(1, n->timeout);
+        ASSERT_EQ(before.hits + 2, rules_get_memo_stats()->hits);
+
+        /* recompiling drops the memos */
+        rules_compile();
+        n->timeout = -1;
+        rule_apply_all(n);
+        ASSERT_EQ(1, n->timeout);
+        ASSERT_EQ(before.misses + 2, rules_get_memo_stats()->misses);
+
+        g_free(n);
+        g_free(m);
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        PASS();
+}
+
+TEST test_rules_stats(void)
+{
+        GSList *saved = rules;
+        bool timing_tmp = settings.rule_timing;
+        rule_t r[2];
+
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        r[0].summary = "*match*";
+        r[0].timeout = 1;
+        r[1].summary = "nothing";
+        r[1].timeout = 2;
+
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        settings.rule_timing = false;
+        notification *n = test_notification("app", "cat", "a match", "body");
+        rule_apply_all(n);
+        rule_apply_all(n);
+
+        ASSERT_EQ(2, r[0].stats.evaluations);
+        ASSERT_EQ(2, r[0].stats.matches);
+        ASSERT_EQ(2, r[1].stats.evaluations);
+        ASSERT_EQ(0, r[1].stats.matches);
+        ASSERT_EQ(0, r[0].stats.time_ns);
+        ASSERT_EQ(0, r[1].stats.time_ns);
+
+        settings.rule_timing = timing_tmp;
+        g_free(n);
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        PASS();
+}
+
+/* Match a single regex summary filter directly and through the compiled index */
+static bool test_regex_match(const char *pattern, const char *summary, bool *compiled)
+{
+        rule_t r;
+        rule_init(&r);
+        r.match_type = MATCH_REGEX;
+        r.summary = (char *) pattern;
+        rule_compile_regexes(&r);
+
+        notification *n = test_notification("app", "cat", summary, "");
+        bool matched = rule_matches_notification(&r, n);
+        *compiled = test_compiled_match(&r, n);
+        g_free(n);
+
+        r.match_type = MATCH_GLOB;
+        rule_compile_regexes(&r);
+
+        return matched;
+}
+
+TEST test_rules_regex(void)
+{
+        const struct {
+                const char *pattern;
+                const char *summary;
+                bool expected;
+        } cases[] = {
+                { "ref",      "Firefox", true },  /* unanchored */
+                { "^Fire",    "Firefox", true },  /* anchored */
+                { "fox$",     "Firefox", true },
+                { "^Firefox$", "Firefox", true },
+                { "^fox",     "Firefox", false },
+                { "^fire",    "Firefox", false },
+                { "Thunder",  "Firefox", false },
+                { "^$",       "",        true },
+                { "x|y",      "",        false },
+        };
+
+        for (int i = 0; i < G_N_ELEMENTS(cases); i++) {
+                bool compiled;
+                bool matched = test_regex_match(cases[i].pattern, cases[i].summary, &compiled);
+
+                ASSERT_EQm(cases[i].pattern, cases[i].expected, matched);
+                ASSERT_EQm(cases[i].pattern, matched, compiled);
+        }
+
+        PASS();
+}
+
+static int test_warnings = 0;
+
+static void test_count_warnings(const gchar *domain, GLogLevelFlags level,
+                                const gchar *message, gpointer data)
+{
+        if (level & G_LOG_LEVEL_WARNING)
+                test_warnings++;
+}
+
+TEST test_rules_regex_invalid(void)
+{
+        rule_t r;
+        rule_init(&r);
+        r.match_type = MATCH_REGEX;
+        r.summary = "([";
+
+        test_warnings = 0;
+        g_log_set_default_handler(test_count_warnings, NULL);
+        rule_compile_regexes(&r);
+
+        notification *n = test_notification("app", "cat", "([", "");
+        bool matched = rule_matches_notification(&r, n);
+        bool compiled = test_compiled_match(&r, n);
+        rule_matches_notification(&r, n);
+        dunst_log_init(true);
+        g_free(n);
+
+        ASSERT_FALSE(r.summary_regex);
+        ASSERT_EQ(1, test_warnings);
+        ASSERT_FALSE(matched);
+        ASSERT_FALSE(compiled);
+
+        PASS();
+}
+
+SUITE(suite_rules)
+{
+        RUN_TEST(test_rules_compiled_matchers);
+        RUN_TEST(test_rules_apply_order);
+        RUN_TEST(test_rules_memo);
+        RUN_TEST(test_rules_stats);
+        RUN_TEST(test_rules_regex);
+        RUN_TEST(test_rules_regex_invalid);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -8,6 +8,15 @@ SUITE_EXTERN(suite_utils);
 SUITE_EXTERN(suite_option_parser);
 SUITE_EXTERN(suite_notification);
 SUITE_EXTERN(suite_markup);
+SUITE_EXTERN(suite_heap);
+SUITE_EXTERN(suite_ring);
+SUITE_EXTERN(suite_intern);
+SUITE_EXTERN(suite_format);
+SUITE_EXTERN(suite_rules);
+SUITE_EXTERN(suite_globset);
+SUITE_EXTERN(suite_icon);
+SUITE_EXTERN(suite_queues);
+SUITE_EXTERN(suite_dbus);
 
 GREATEST_MAIN_DEFS();
 
@@ -20,6 +29,15 @@ int main(int argc, char *argv[]) {
         RUN_SUITE(suite_option_parser);
         RUN_SUITE(suite_notification);
         RUN_SUITE(suite_markup);
+        RUN_SUITE(suite_heap);
+        RUN_SUITE(suite_ring);
+        RUN_SUITE(suite_intern);
+        RUN_SUITE(suite_format);
+        RUN_SUITE(suite_rules);
+        RUN_SUITE(suite_globset);
+        RUN_SUITE(suite_icon);
+        RUN_SUITE(suite_queues);
+        RUN_SUITE(suite_dbus);
         GREATEST_MAIN_END();
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
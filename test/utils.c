@@ -172,6 +172,30 @@ TEST test_string_to_time(void)
         PASS();
 }
 
+TEST test_frame_delay(void)
+{
+        const gint64 frame = G_USEC_PER_SEC / 50;
+        const gint64 last = 10 * G_USEC_PER_SEC;
+
+        /* unlimited */
+        ASSERT_EQ(0, frame_delay(last, last, 0));
+        ASSERT_EQ(0, frame_delay(last, last, -1));
+
+        /* a full frame passed already */
+        ASSERT_EQ(0, frame_delay(last + frame, last, 50));
+        ASSERT_EQ(0, frame_delay(last + 3 * frame, last, 50));
+
+        /* never longer than a frame */
+        ASSERT_EQ(frame, frame_delay(last, last, 50));
+        ASSERT_EQ(frame, frame_delay(last - G_USEC_PER_SEC, last, 50));
+
+        /* all wake ups within a frame get coalesced to its end */
+        for (gint64 now = last; now < last + frame; now += frame / 7)
+                ASSERT_EQ(last + frame, now + frame_delay(now, last, 50));
+
+        PASS();
+}
+
 SUITE(suite_utils)
 {
         RUN_TEST(test_string_replace_char);
@@ -181,5 +205,6 @@ SUITE(suite_utils)
         RUN_TEST(test_string_strip_delimited);
         RUN_TEST(test_string_to_path);
         RUN_TEST(test_string_to_time);
+        RUN_TEST(test_frame_delay);
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */